@@ -112,6 +112,14 @@ public:
         cm256_block* originals,      // Array of pointers to original blocks
         uint8_t ** recoveryBlocks);  // Output recovery blocks array
 
+    // Encode one block, any recovery block index up to 255 may be asked for.
+    // Note: This function does not validate input, use with care.
+    void cm256_encode_block(
+        cm256_encoder_params params, // Encoder parameters
+        cm256_block* originals,      // Array of pointers to original blocks
+        int recoveryBlockIndex,      // Return value from cm256_get_recovery_block_index()
+        void* recoveryBlock);        // Output recovery block
+
     /*
      * Cauchy MDS GF(256) decode
      *
@@ -187,14 +195,6 @@ private:
         gf256_ctx& m_gf256Ctx;
     };
 
-    // Encode one block.
-    // Note: This function does not validate input, use with care.
-    void cm256_encode_block(
-        cm256_encoder_params params, // Encoder parameters
-        cm256_block* originals,      // Array of pointers to original blocks
-        int recoveryBlockIndex,      // Return value from cm256_get_recovery_block_index()
-        void* recoveryBlock);        // Output recovery block
-
     gf256_ctx m_gf256Ctx;
     bool m_initialized;
 };
@@ -34,6 +34,323 @@
 typedef void (*encode_callback_t)(void * user_data, const uint8_t * dst_data, uint32_t dst_size);
 typedef void (*decode_callback_t)(void * user_data, const uint8_t * dst_data, uint32_t dst_size);
 
+struct frame_range_t
+{
+    uint32_t                offset;                 // first byte of the range in the frame
+    uint32_t                size;                   // bytes of the range
+
+    frame_range_t(uint32_t range_offset = 0, uint32_t range_size = 0)
+        : offset(range_offset)
+        , size(range_size)
+    {
+
+    }
+};
+
+typedef void (*partial_decode_callback_t)(void * user_data, const uint8_t * dst_data, uint32_t dst_size, const frame_range_t * valid_ranges, uint32_t valid_range_count);
+typedef uint64_t (*decode_clock_t)(void * user_data);
+
+struct encode_option_t
+{
+    uint32_t                max_block_size;         // max size of one packet on the wire
+    double                  recovery_rate;          // recovery blocks / (original blocks + recovery blocks) of a full group
+    uint8_t                 max_original_count;     // cap of original blocks per group, smaller groups decode sooner and cheaper
+    bool                    force_recovery;         // every group gets one recovery block at least
+    uint8_t                 header_version;         // 1: standard header, 2: compact header, the decoder must know version 2
+    uint8_t                 group_id_bits;          // 16 or 24, width of the wrapping group id of the compact header
+    bool                    balanced_groups;        // split a frame into groups of near equal size instead of full groups and a small rest
+    bool                    adaptive_block_size;    // pick the block size up to max_block_size that sends the fewest bytes for each frame
+    bool                    shorten_last_block;     // send the last original block of a group without its zero padding
+    uint32_t                aggregate_bytes;        // header version 2 only, frames up to this size are held and packed into one shared group, 0: off
+    uint32_t                aggregate_millisecond;  // held frames are sent by the first encode() this long after the oldest of them, call flush() to bound an idle stream
+    uint32_t                interleave_depth;       // packets of up to this many consecutive groups are sent interleaved against burst loss, 0 or 1: off
+    uint32_t                interleave_millisecond; // groups may wait this long for groups of later frames to interleave with, 0: only groups of one encode()
+    bool                    adaptive_recovery;      // derive the recovery rate of each frame from the receive reports passed to feedback(), recovery_rate is the rate until the first one
+    double                  target_loss_rate;       // adaptive recovery: accepted probability that a group cannot be recovered
+    double                  max_recovery_rate;      // adaptive recovery: upper bound of the derived rate
+    bool                    send_timestamp;         // header_version 2 only, packets carry the send time and pacing duration of their frame, the decoder expires each group at its own deadline
+    uint32_t                repair_cache_groups;    // originals of this many latest groups are kept to answer repair() with block ids up to 255 not sent before, 0: off
+
+    encode_option_t()
+        : max_block_size(1100)
+        , recovery_rate(0.1)
+        , max_original_count(255)
+        , force_recovery(true)
+        , header_version(1)
+        , group_id_bits(16)
+        , balanced_groups(false)
+        , adaptive_block_size(false)
+        , shorten_last_block(false)
+        , aggregate_bytes(0)
+        , aggregate_millisecond(5)
+        , interleave_depth(0)
+        , interleave_millisecond(0)
+        , adaptive_recovery(false)
+        , target_loss_rate(0.001)
+        , max_recovery_rate(0.5)
+        , send_timestamp(false)
+        , repair_cache_groups(0)
+    {
+
+    }
+};
+
+struct protect_range_t
+{
+    uint32_t                offset;                 // first byte of the range in the frame
+    uint32_t                size;                   // bytes of the range
+    double                  recovery_rate;          // recovery rate of the groups that carry the range
+
+    protect_range_t(uint32_t range_offset = 0, uint32_t range_size = 0, double range_recovery_rate = 0.1)
+        : offset(range_offset)
+        , size(range_size)
+        , recovery_rate(range_recovery_rate)
+    {
+
+    }
+};
+
+struct frame_option_t
+{
+    double                  recovery_rate;          // overrides encode_option_t::recovery_rate for this frame, < 0: keep it
+    uint8_t                 max_original_count;     // overrides encode_option_t::max_original_count for this frame, 0: keep it
+    uint8_t                 priority;               // 0: may be held for aggregation and interleaving, > 0: sent at once after everything held before it
+    std::vector<protect_range_t> protect_ranges;    // header_version 2 only, disjoint ranges coded in groups of their own rate, the rest of the frame uses recovery_rate
+    uint32_t                timestamp;              // send_timestamp: sender milliseconds of the frame (wrapping), 0: the clock of the encoder
+    uint16_t                duration;               // send_timestamp: milliseconds the packets of the frame are paced over after timestamp
+
+    frame_option_t()
+        : recovery_rate(-1.0)
+        , max_original_count(0)
+        , priority(0)
+        , protect_ranges()
+        , timestamp(0)
+        , duration(0)
+    {
+
+    }
+};
+
+struct encode_stats_t
+{
+    uint32_t                frame_size;             // size of the last encoded frame, or of all frames of the last aggregated group
+    uint32_t                block_size;             // size of each of its packets on the wire
+    uint32_t                group_count;            // groups the frame was split into
+    uint32_t                original_count;         // original blocks of all its groups
+    uint32_t                recovery_count;         // recovery blocks of all its groups
+    uint64_t                transmit_bytes;         // wire bytes of all its packets
+
+    encode_stats_t()
+        : frame_size(0)
+        , block_size(0)
+        , group_count(0)
+        , original_count(0)
+        , recovery_count(0)
+        , transmit_bytes(0)
+    {
+
+    }
+};
+
+struct encode_counters_t
+{
+    uint64_t                input_frames;           // frames given to encode()
+    uint64_t                input_bytes;            // their bytes
+    uint64_t                output_packets;         // packets out of encode(), flush(), repair() and repair_nack()
+    uint64_t                output_bytes;           // their bytes on the wire
+    uint64_t                repair_packets;         // packets out of repair() and repair_nack(), included in output_packets
+
+    encode_counters_t()
+        : input_frames(0)
+        , input_bytes(0)
+        , output_packets(0)
+        , output_bytes(0)
+        , repair_packets(0)
+    {
+
+    }
+};
+
+struct receive_report_t
+{
+    uint32_t                expected_blocks;        // packets the groups seen since the last report were sent with
+    uint32_t                received_blocks;        // packets that arrived since the last report
+    uint32_t                complete_groups;        // groups decoded from their original blocks alone
+    uint32_t                recovered_groups;       // groups decoded with recovery blocks
+    uint32_t                lost_groups;            // groups that expired or failed to decode
+    uint32_t                burst_histogram[6];     // runs of lost packets inside a group, of length 1, 2, 3-4, 5-8, 9-16, 17+
+
+    receive_report_t()
+        : expected_blocks(0)
+        , received_blocks(0)
+        , complete_groups(0)
+        , recovered_groups(0)
+        , lost_groups(0)
+        , burst_histogram()
+    {
+
+    }
+};
+
+/*
+ * the buffer budget is on by default, init(expire_millisecond, nack_millisecond) included: at most 4096 incomplete groups and 64 MB,
+ * a stream that needs more (many large frames in flight, long expiry) has to raise or clear max_buffered_groups and max_buffered_bytes
+ */
+struct decode_option_t
+{
+    uint32_t                expire_millisecond;     // an incomplete group is given up this long after its first block, or after it was due when the packets carry send timestamps
+    uint32_t                nack_millisecond;       // nack() reports a group incomplete this long after its first block or its last nack
+    uint32_t                playout_millisecond;    // send_timestamp streams only, frames are held and released this long after they were due, late and early ones are counted, 0: off
+    bool                    partial_frames;         // frames with unrecoverable groups are delivered with the byte ranges that arrived, by the decode() overloads with validity maps only
+    decode_clock_t          clock;                  // microseconds from any epoch that never goes back, read once per call, nullptr: the steady clock
+    void                  * clock_user_data;
+    uint32_t                max_buffered_groups;    // incomplete groups held at most, the oldest are evicted beyond, 0: no limit
+    uint64_t                max_buffered_bytes;     // block and frame bytes held at most, evicted the same way, should hold several full groups, 0: no limit
+
+    decode_option_t()
+        : expire_millisecond(15)
+        , nack_millisecond(0)
+        , playout_millisecond(0)
+        , partial_frames(false)
+        , clock(nullptr)
+        , clock_user_data(nullptr)
+        , max_buffered_groups(4096)
+        , max_buffered_bytes(64 * 1024 * 1024)
+    {
+
+    }
+};
+
+struct playout_stats_t
+{
+    uint32_t                held_frames;            // frames waiting for their release time
+    uint32_t                wait_millisecond;       // until the first held frame is released, call decode() with no data then
+    uint32_t                released_frames;        // frames released by the playout stage since init() or reset(), late and early ones included
+    uint32_t                late_frames;            // frames decoded after their release time, released at once
+    uint32_t                early_frames;           // frames decoded too far ahead of their release time, released at once
+    uint32_t                playout_delay;          // milliseconds the latest frame was held behind its expected arrival: its duration, four times the jitter and playout_millisecond
+
+    playout_stats_t()
+        : held_frames(0)
+        , wait_millisecond(0)
+        , released_frames(0)
+        , late_frames(0)
+        , early_frames(0)
+        , playout_delay(0)
+    {
+
+    }
+};
+
+struct decode_counters_t
+{
+    uint64_t                input_packets;          // packets given to decode()
+    uint64_t                input_bytes;            // their bytes
+    uint64_t                invalid_packets;        // packets not recognizable, malformed or not matching their group
+    uint64_t                duplicate_packets;      // blocks that were held already
+    uint64_t                stale_packets;          // blocks of groups decoded or given up already
+    uint64_t                complete_groups;        // groups decoded from their original blocks alone
+    uint64_t                recovered_groups;       // groups decoded with recovery blocks
+    uint64_t                expired_groups;         // groups given up incomplete
+    uint64_t                failed_groups;          // groups that had enough blocks but did not decode
+    uint64_t                recovered_blocks;       // original blocks rebuilt from recovery blocks
+    uint64_t                output_frames;          // frames delivered, partial ones included
+    uint64_t                output_bytes;           // their bytes
+    uint64_t                partial_frames;         // frames delivered with a validity map of the bytes that arrived
+    uint64_t                dropped_frames;         // frames given up with part of their groups decoded, frames with all groups lost show in expired_groups only
+    uint64_t                buffered_groups;        // groups waiting for blocks or for the groups before them, now
+    uint64_t                buffered_bytes;         // block bytes these groups and the frames in assembly hold, now
+    uint64_t                evicted_groups;         // groups given up over max_buffered_groups or max_buffered_bytes
+    uint64_t                evicted_frames;         // frames in assembly given up over max_buffered_bytes or with an evicted group they need
+    uint64_t                evicted_bytes;          // bytes these groups and frames held
+
+    decode_counters_t()
+        : input_packets(0)
+        , input_bytes(0)
+        , invalid_packets(0)
+        , duplicate_packets(0)
+        , stale_packets(0)
+        , complete_groups(0)
+        , recovered_groups(0)
+        , expired_groups(0)
+        , failed_groups(0)
+        , recovered_blocks(0)
+        , output_frames(0)
+        , output_bytes(0)
+        , partial_frames(0)
+        , dropped_frames(0)
+        , buffered_groups(0)
+        , buffered_bytes(0)
+        , evicted_groups(0)
+        , evicted_frames(0)
+        , evicted_bytes(0)
+    {
+
+    }
+};
+
+/*
+ * values are recorded into log-linear buckets in the manner of HdrHistogram, histograms of several coders can be merged,
+ * counts[] with bucket_value() is the complete content for export
+ */
+struct CAUCHY_FEC_TYPE latency_histogram_t
+{
+    enum
+    {
+        sub_bucket_count = 16,                      // buckets per power of two, so a bucket is at most 1/16 of its value wide
+        bucket_count = 16 + 32 * 16                 // values from 2^36 on go to the last bucket
+    };
+
+    uint64_t                counts[bucket_count];   // samples per bucket, bucket_value() is the lowest value of a bucket
+    uint64_t                total_count;            // samples
+    uint64_t                min_value;              // lowest sample, 0 without samples
+    uint64_t                max_value;              // highest sample
+    uint64_t                sum;                    // of all samples, for the mean
+
+    latency_histogram_t()
+        : counts()
+        , total_count(0)
+        , min_value(0)
+        , max_value(0)
+        , sum(0)
+    {
+
+    }
+
+    void record(uint64_t value);
+    void merge(const latency_histogram_t & other);
+    uint64_t percentile(double rank) const;        // rank from 0.0 to 1.0, 0.99 for the 99th percentile
+
+    static uint32_t bucket_index(uint64_t value);
+    static uint64_t bucket_value(uint32_t bucket);
+};
+
+struct encode_latency_t
+{
+    latency_histogram_t     encode_time;            // nanoseconds per encode() call
+
+    encode_latency_t()
+        : encode_time()
+    {
+
+    }
+};
+
+struct decode_latency_t
+{
+    latency_histogram_t     group_latency;          // decoder clock microseconds from the first block of a group until it decoded
+    latency_histogram_t     frame_latency;          // decoder clock microseconds from the first block of a frame until it was delivered
+    latency_histogram_t     decode_time;            // nanoseconds in the cauchy decoder per group that needed recovery blocks
+
+    decode_latency_t()
+        : group_latency()
+        , frame_latency()
+        , decode_time()
+    {
+
+    }
+};
+
 class CauchyFecEncoderImpl;
 class CauchyFecDecoderImpl;
 
@@ -49,11 +366,32 @@ public:
 
 public:
     bool init(uint32_t max_block_size, double recovery_rate, bool force_recovery);
+    bool init(const encode_option_t & option);
     void exit();
 
 public:
     bool encode(const uint8_t * src_data, uint32_t src_size, std::list<std::vector<uint8_t>> & dst_list);
     bool encode(const uint8_t * src_data, uint32_t src_size, encode_callback_t encode_callback, void * user_data);
+    bool encode(const uint8_t * src_data, uint32_t src_size, const frame_option_t & frame_option, std::list<std::vector<uint8_t>> & dst_list);
+    bool encode(const uint8_t * src_data, uint32_t src_size, const frame_option_t & frame_option, encode_callback_t encode_callback, void * user_data);
+
+public:
+    bool flush(std::list<std::vector<uint8_t>> & dst_list);
+    bool flush(encode_callback_t encode_callback, void * user_data);
+
+public:
+    bool get_stats(encode_stats_t & encode_stats);
+    bool get_counters(encode_counters_t & encode_counters);  // totals since init(), safe to call from another thread while one encodes
+    bool get_latency(encode_latency_t & encode_latency);     // histograms since init(), as safe as get_counters()
+
+public:
+    bool feedback(const receive_report_t & receive_report);
+
+public:
+    bool repair(uint64_t group_id, uint32_t block_count, std::list<std::vector<uint8_t>> & dst_list);
+    bool repair(uint64_t group_id, uint32_t block_count, encode_callback_t encode_callback, void * user_data);
+    bool repair_nack(const uint8_t * nack_data, uint32_t nack_size, std::list<std::vector<uint8_t>> & dst_list);
+    bool repair_nack(const uint8_t * nack_data, uint32_t nack_size, encode_callback_t encode_callback, void * user_data);
 
 public:
     void reset();
@@ -73,16 +411,30 @@ public:
     ~CauchyFecDecoder();
 
 public:
-    bool init(uint32_t expire_millisecond = 15);
+    bool init(uint32_t expire_millisecond = 15, uint32_t nack_millisecond = 0);
+    bool init(const decode_option_t & option);
     void exit();
 
 public:
     bool decode(const uint8_t * src_data, uint32_t src_size, std::list<std::vector<uint8_t>> & dst_list);
     bool decode(const uint8_t * src_data, uint32_t src_size, decode_callback_t decode_callback, void * user_data);
+    bool decode(const uint8_t * src_data, uint32_t src_size, std::list<std::vector<uint8_t>> & dst_list, std::list<std::vector<frame_range_t>> & range_list);
+    bool decode(const uint8_t * src_data, uint32_t src_size, partial_decode_callback_t decode_callback, void * user_data);
 
 public:
     static bool recognizable(const uint8_t * src_data, uint32_t src_size);
 
+public:
+    bool get_report(receive_report_t & receive_report);
+    bool get_playout_stats(playout_stats_t & playout_stats);
+    bool get_counters(decode_counters_t & decode_counters);  // totals since init(), safe to call from another thread while one decodes
+    bool get_latency(decode_latency_t & decode_latency);     // histograms since init(), as safe as get_counters()
+    bool nack(std::vector<uint8_t> & nack_data);    // missing block counts of the groups still incomplete nack_millisecond after their first block or their last nack, for repair_nack()
+
+public:
+    bool start_capture(const char * file_path);     // record every later decode() and reset() call with its decoder clock time to file_path, for replay
+    void stop_capture();
+
 public:
     void reset();
 
@@ -14,7 +14,11 @@
 #endif // _MSC_VER
 
 #include <ctime>
+#include <atomic>
+#include <chrono>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
 #include <cstdint>
 #include <cstring>
 #include <map>
@@ -25,7 +29,29 @@
 #include "cm256.h"
 #include "cauchy_fec.h"
 
+/*
+ * USDT probes of provider cauchy_fec for perf and bpftrace, built in with -DCAUCHY_FEC_USDT (make usdt=yes),
+ * a probe that is not traced costs one nop:
+ *     block_insert(group_id, block_id, original_count, recovery_count, block_size)    every block with a valid head
+ *     group_decode_start(group_id, original_count, recovery_count, block_size, recovery_blocks)
+ *     group_decode_end(group_id, original_count, recovery_count, decoded, frame_count)
+ *     group_expire(group_id, original_count, recovery_count, block_count, wait_microseconds)
+ *     frame_deliver(frame_size, valid_range_count, wait_microseconds)                   valid_range_count is 0 for a complete frame
+ */
+#if defined(CAUCHY_FEC_USDT) && !defined(_MSC_VER)
+    #include <sys/sdt.h>
+    #define CAUCHY_FEC_PROBE3(name, a1, a2, a3)                 DTRACE_PROBE3(cauchy_fec, name, a1, a2, a3)
+    #define CAUCHY_FEC_PROBE5(name, a1, a2, a3, a4, a5)         DTRACE_PROBE5(cauchy_fec, name, a1, a2, a3, a4, a5)
+#else
+    #define CAUCHY_FEC_PROBE3(name, a1, a2, a3)                 do { } while (0)
+    #define CAUCHY_FEC_PROBE5(name, a1, a2, a3, a4, a5)         do { } while (0)
+#endif
+
 const uint8_t s_protocol = 0xcf;
+const uint8_t s_compact_protocol = 0xce;
+const uint8_t s_nack_protocol = 0xcd;
+const uint32_t s_cache_line = 64;
+const uint32_t s_adaptive_block_counts = 8;
 
 static void byte_order_convert(void * obj, size_t size)
 {
@@ -124,21 +150,316 @@ struct block_t
 
 #pragma pack(pop)
 
+/*
+ * compact header, the first byte is s_compact_protocol:
+ *     protocol(1) flags(1) group_id(2 or 3, wrapping) block_id(1) original_count(1) recovery_count(1) [timestamp(4) duration(2)]
+ * timestamp and duration are there with s_compact_flag_timestamp, the sender milliseconds of the frame (wrapping)
+ * and the milliseconds its packets are paced over
+ * the coded region of a compact group is one stream of frame records, split over the original blocks
+ * in block_id order and zero padded at its end, every record is
+ *     varint frame_size (0 ends the stream), varint frame_offset, varint frame_index, varint frame_count, varint bytes, data
+ * a standard header starts with the 64-bit group id, group ids wrap below 0xce << 56 so that none looks like a compact header,
+ * the wrap is a multiple of every compact group id width, so compact group ids run on across it
+ */
+const uint8_t s_compact_flag_wide_group_id = 0x01;
+const uint8_t s_compact_flag_timestamp = 0x02;
+const uint8_t s_compact_flags = s_compact_flag_wide_group_id | s_compact_flag_timestamp;
+const uint64_t s_group_id_limit = static_cast<uint64_t>(s_compact_protocol) << 56;
+
+static void next_group_id(uint64_t & group_id)
+{
+    group_id = (group_id + 1 < s_group_id_limit ? group_id + 1 : 0);
+}
+
+struct block_format_t
+{
+    uint8_t                             protocol;
+    uint8_t                             flags;
+    uint32_t                            head_size;
+    uint32_t                            group_id_bits;
+    uint32_t                            timestamp;
+    uint16_t                            duration;
+};
+
+static void make_block_format(uint8_t protocol, uint8_t flags, block_format_t & block_format)
+{
+    block_format.protocol = protocol;
+    block_format.flags = flags;
+    block_format.timestamp = 0;
+    block_format.duration = 0;
+    if (s_compact_protocol == protocol)
+    {
+        block_format.group_id_bits = (0 != (flags & s_compact_flag_wide_group_id) ? 24 : 16);
+        block_format.head_size = 5 + block_format.group_id_bits / 8 + (0 != (flags & s_compact_flag_timestamp) ? 6 : 0);
+    }
+    else
+    {
+        block_format.group_id_bits = 64;
+        block_format.head_size = sizeof(block_head_t);
+    }
+}
+
+static uint32_t varint_size(uint32_t value)
+{
+    uint32_t size = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+struct record_head_t
+{
+    uint32_t                            frame_size;
+    uint32_t                            frame_offset;
+    uint32_t                            frame_index;
+    uint32_t                            frame_count;
+    uint32_t                            bytes;
+
+    uint32_t size() const
+    {
+        return varint_size(frame_size) + varint_size(frame_offset) + varint_size(frame_index) + varint_size(frame_count) + varint_size(bytes);
+    }
+};
+
+struct record_t
+{
+    record_head_t                       head;
+    const uint8_t *                     data;
+};
+
+static uint32_t cache_line_align(uint32_t size)
+{
+    return (size + s_cache_line - 1) / s_cache_line * s_cache_line;
+}
+
+/*
+ * internal storage of one block, the wire packet is placed so that its coded region
+ * (everything behind the block head) starts on a cache line and is zero padded to whole cache lines,
+ * the wire packet itself stays contiguous and unchanged
+ */
+struct block_buffer_t
+{
+    std::vector<uint8_t>                storage;
+    uint32_t                            offset;
+    uint32_t                            size;
+    uint32_t                            head_size;
+    uint8_t                             block_id;
+
+    block_buffer_t()
+        : storage()
+        , offset(0)
+        , size(0)
+        , head_size(0)
+        , block_id(0)
+    {
+
+    }
+
+    void assign(uint32_t block_size, uint32_t block_head_size)
+    {
+        assert(block_size >= block_head_size && block_head_size <= s_cache_line);
+
+        storage.assign(s_cache_line * 2 + cache_line_align(block_size - block_head_size), 0x0);
+        const uintptr_t coded_address = reinterpret_cast<uintptr_t>(&storage[0]) + block_head_size;
+        offset = static_cast<uint32_t>((s_cache_line - coded_address % s_cache_line) % s_cache_line);
+        size = block_size;
+        head_size = block_head_size;
+    }
+
+    void assign(const void * block_data, uint32_t block_size, uint32_t block_head_size)
+    {
+        assign(block_size, block_head_size);
+        memcpy(data(), block_data, block_size);
+    }
+
+    void extend(uint32_t block_size)
+    {
+        if (block_size > size)
+        {
+            const std::vector<uint8_t> block_data(data(), data() + size);
+            assign(block_size, head_size);
+            memcpy(data(), &block_data[0], block_data.size());
+        }
+    }
+
+    uint8_t * data()
+    {
+        return &storage[offset];
+    }
+
+    block_t * block()
+    {
+        return reinterpret_cast<block_t *>(data());
+    }
+
+    uint8_t * coded()
+    {
+        return data() + head_size;
+    }
+};
+
+/*
+ * byte stream over the coded regions of the original blocks of a compact group
+ */
+struct group_stream_t
+{
+    uint8_t * const *                   blocks;
+    uint32_t                            block_count;
+    uint32_t                            block_bytes;
+    uint64_t                            position;
+
+    group_stream_t(uint8_t * const * stream_blocks, uint32_t stream_block_count, uint32_t stream_block_bytes)
+        : blocks(stream_blocks)
+        , block_count(stream_block_count)
+        , block_bytes(stream_block_bytes)
+        , position(0)
+    {
+
+    }
+
+    uint64_t remain() const
+    {
+        return static_cast<uint64_t>(block_count) * block_bytes - position;
+    }
+
+    bool write(const void * data, uint32_t size)
+    {
+        if (remain() < size)
+        {
+            return false;
+        }
+
+        const uint8_t * src = static_cast<const uint8_t *>(data);
+        while (0 != size)
+        {
+            const uint32_t block_offset = static_cast<uint32_t>(position % block_bytes);
+            const uint32_t bytes = std::min<uint32_t>(size, block_bytes - block_offset);
+            memcpy(blocks[position / block_bytes] + block_offset, src, bytes);
+            src += bytes;
+            size -= bytes;
+            position += bytes;
+        }
+
+        return true;
+    }
+
+    bool read(void * data, uint32_t size)
+    {
+        if (remain() < size)
+        {
+            return false;
+        }
+
+        uint8_t * dst = static_cast<uint8_t *>(data);
+        while (0 != size)
+        {
+            const uint32_t block_offset = static_cast<uint32_t>(position % block_bytes);
+            const uint32_t bytes = std::min<uint32_t>(size, block_bytes - block_offset);
+            memcpy(dst, blocks[position / block_bytes] + block_offset, bytes);
+            dst += bytes;
+            size -= bytes;
+            position += bytes;
+        }
+
+        return true;
+    }
+
+    bool write_varint(uint32_t value)
+    {
+        uint8_t bytes[5] = { 0x0 };
+        uint32_t size = 0;
+        do
+        {
+            bytes[size] = static_cast<uint8_t>(value & 0x7f);
+            value >>= 7;
+            if (0 != value)
+            {
+                bytes[size] |= 0x80;
+            }
+            ++size;
+        } while (0 != value);
+        return write(bytes, size);
+    }
+
+    bool read_varint(uint32_t & value)
+    {
+        value = 0;
+        for (uint32_t shift = 0; shift < 35; shift += 7)
+        {
+            uint8_t byte = 0;
+            if (!read(&byte, 1) || (28 == shift && byte > 0x0f))
+            {
+                return false;
+            }
+            value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (0 == (byte & 0x80))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool write_record(const record_head_t & record_head)
+    {
+        return write_varint(record_head.frame_size) && write_varint(record_head.frame_offset) && write_varint(record_head.frame_index) && write_varint(record_head.frame_count) && write_varint(record_head.bytes);
+    }
+
+    bool read_record(record_head_t & record_head)
+    {
+        record_head.frame_size = 0;
+        if (0 == remain())
+        {
+            return true;
+        }
+        if (!read_varint(record_head.frame_size))
+        {
+            return false;
+        }
+        if (0 == record_head.frame_size)
+        {
+            return true;
+        }
+        return read_varint(record_head.frame_offset) && read_varint(record_head.frame_index) && read_varint(record_head.frame_count) && read_varint(record_head.bytes);
+    }
+};
+
 struct group_head_t
 {
     uint64_t                            group_id;
+    uint8_t                             protocol;
     uint8_t                             original_count;
     uint8_t                             recovery_count;
     uint8_t                             block_count;
     uint32_t                            block_size;
+    bool                                block_size_known;
+    uint8_t                             group_id_bits;
+    uint16_t                            next_block_id;
+    bool                                timestamped;
+    uint32_t                            timestamp;
+    uint16_t                            duration;
+    uint32_t                            buffered_bytes;
+    uint64_t                            first_time;
     uint8_t                             block_bitmap[32];
 
     group_head_t()
         : group_id(0)
+        , protocol(0)
         , original_count(0)
         , recovery_count(0)
         , block_count(0)
         , block_size(0)
+        , block_size_known(false)
+        , group_id_bits(0)
+        , next_block_id(0)
+        , timestamped(false)
+        , timestamp(0)
+        , duration(0)
+        , buffered_bytes(0)
+        , first_time(0)
         , block_bitmap()
     {
         memset(block_bitmap, 0x0, sizeof(block_bitmap));
@@ -147,8 +468,8 @@ struct group_head_t
 
 struct group_body_t
 {
-    std::list<std::vector<uint8_t>>     original_list;
-    std::list<std::vector<uint8_t>>     recovery_list;
+    std::list<block_buffer_t>           original_list;
+    std::list<block_buffer_t>           recovery_list;
 };
 
 struct group_src_t
@@ -163,16 +484,40 @@ struct group_dst_t
     uint64_t                            max_group_id;
     std::vector<bool>                   group_status;
     std::vector<uint8_t>                data;
+    std::vector<frame_range_t>          valid_ranges;
+    uint64_t                            first_time;
+    uint32_t                            buffered_bytes;
+    bool                                timestamped;
+    uint32_t                            timestamp;
+    uint16_t                            duration;
 
     group_dst_t()
         : min_group_id(0)
         , max_group_id(0)
         , group_status()
         , data()
+        , valid_ranges()
+        , first_time(0)
+        , buffered_bytes(0)
+        , timestamped(false)
+        , timestamp(0)
+        , duration(0)
     {
 
     }
 
+    void validate(uint32_t offset, uint32_t size)
+    {
+        if (!valid_ranges.empty() && valid_ranges.back().offset + valid_ranges.back().size == offset)
+        {
+            valid_ranges.back().size += size;
+        }
+        else if (0 != size)
+        {
+            valid_ranges.push_back(frame_range_t(offset, size));
+        }
+    }
+
     bool complete() const
     {
         if (min_group_id >= max_group_id || group_status.size() != max_group_id - min_group_id)
@@ -190,27 +535,170 @@ struct group_dst_t
     }
 };
 
+/*
+ * written by the decoding thread alone, so a relaxed load and store is enough and costs no locked instruction,
+ * any other thread may read them at any time
+ */
+static void add_counter(std::atomic<uint64_t> & counter, uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+static void set_counter(std::atomic<uint64_t> & counter, uint64_t value)
+{
+    counter.store(value, std::memory_order_relaxed);
+}
+
+static uint64_t get_counter(const std::atomic<uint64_t> & counter)
+{
+    return counter.load(std::memory_order_relaxed);
+}
+
+struct histogram_counter_t
+{
+    std::atomic<uint64_t>               counts[latency_histogram_t::bucket_count];
+    std::atomic<uint64_t>               min_value;
+    std::atomic<uint64_t>               max_value;
+    std::atomic<uint64_t>               sum;
+
+    histogram_counter_t()
+        : min_value(~static_cast<uint64_t>(0))
+        , max_value(0)
+        , sum(0)
+    {
+        for (uint32_t bucket = 0; bucket < latency_histogram_t::bucket_count; ++bucket)
+        {
+            set_counter(counts[bucket], 0);
+        }
+    }
+};
+
+static void record_histogram(histogram_counter_t & histogram, uint64_t value)
+{
+    add_counter(histogram.counts[latency_histogram_t::bucket_index(value)], 1);
+    add_counter(histogram.sum, value);
+    if (value < get_counter(histogram.min_value))
+    {
+        set_counter(histogram.min_value, value);
+    }
+    if (value > get_counter(histogram.max_value))
+    {
+        set_counter(histogram.max_value, value);
+    }
+}
+
+/*
+ * total_count is summed up from the copied buckets, so the snapshot is consistent in itself even while samples come in
+ */
+static void read_histogram(const histogram_counter_t & histogram, latency_histogram_t & latency_histogram)
+{
+    latency_histogram.total_count = 0;
+    for (uint32_t bucket = 0; bucket < latency_histogram_t::bucket_count; ++bucket)
+    {
+        latency_histogram.counts[bucket] = get_counter(histogram.counts[bucket]);
+        latency_histogram.total_count += latency_histogram.counts[bucket];
+    }
+    latency_histogram.min_value = (0 != latency_histogram.total_count ? get_counter(histogram.min_value) : 0);
+    latency_histogram.max_value = get_counter(histogram.max_value);
+    latency_histogram.sum = get_counter(histogram.sum);
+}
+
+struct decode_counter_t
+{
+    std::atomic<uint64_t>               input_packets;
+    std::atomic<uint64_t>               input_bytes;
+    std::atomic<uint64_t>               invalid_packets;
+    std::atomic<uint64_t>               duplicate_packets;
+    std::atomic<uint64_t>               stale_packets;
+    std::atomic<uint64_t>               complete_groups;
+    std::atomic<uint64_t>               recovered_groups;
+    std::atomic<uint64_t>               expired_groups;
+    std::atomic<uint64_t>               failed_groups;
+    std::atomic<uint64_t>               recovered_blocks;
+    std::atomic<uint64_t>               output_frames;
+    std::atomic<uint64_t>               output_bytes;
+    std::atomic<uint64_t>               partial_frames;
+    std::atomic<uint64_t>               dropped_frames;
+    std::atomic<uint64_t>               buffered_groups;
+    std::atomic<uint64_t>               buffered_bytes;
+    std::atomic<uint64_t>               evicted_groups;
+    std::atomic<uint64_t>               evicted_frames;
+    std::atomic<uint64_t>               evicted_bytes;
+    histogram_counter_t                 group_latency;
+    histogram_counter_t                 frame_latency;
+    histogram_counter_t                 decode_time;
+
+    decode_counter_t()
+        : input_packets(0)
+        , input_bytes(0)
+        , invalid_packets(0)
+        , duplicate_packets(0)
+        , stale_packets(0)
+        , complete_groups(0)
+        , recovered_groups(0)
+        , expired_groups(0)
+        , failed_groups(0)
+        , recovered_blocks(0)
+        , output_frames(0)
+        , output_bytes(0)
+        , partial_frames(0)
+        , dropped_frames(0)
+        , buffered_groups(0)
+        , buffered_bytes(0)
+        , evicted_groups(0)
+        , evicted_frames(0)
+        , evicted_bytes(0)
+        , group_latency()
+        , frame_latency()
+        , decode_time()
+    {
+
+    }
+};
+
 struct decode_timer_t
 {
     uint64_t                            group_id;
-    uint32_t                            decode_seconds;
-    uint32_t                            decode_microseconds;
+    uint64_t                            decode_time;
+    uint64_t                            nack_time;
 };
 
 struct groups_t
 {
     uint64_t                            min_group_id;
     uint64_t                            new_group_id;
+    uint64_t                            serial_group_id;
+    bool                                serial_valid;
     std::map<uint64_t, group_src_t>     src_item;
     std::map<uint64_t, group_dst_t>     dst_item;
     std::list<decode_timer_t>           decode_timer_list;
+    receive_report_t                    report;
+    decode_counter_t                    counters;
+    uint64_t                            buffered_bytes;
+    uint32_t                            max_buffered_groups;
+    uint64_t                            max_buffered_bytes;
+    bool                                transit_valid;
+    uint32_t                            transit_base;
+    double                              transit_delta;
+    double                              jitter;
 
     groups_t()
         : min_group_id(0)
         , new_group_id(0)
+        , serial_group_id(0)
+        , serial_valid(false)
         , src_item()
         , dst_item()
         , decode_timer_list()
+        , report()
+        , counters()
+        , buffered_bytes(0)
+        , max_buffered_groups(0)
+        , max_buffered_bytes(0)
+        , transit_valid(false)
+        , transit_base(0)
+        , transit_delta(0.0)
+        , jitter(0.0)
     {
 
     }
@@ -219,9 +707,17 @@ struct groups_t
     {
         min_group_id = 0;
         new_group_id = 0;
+        serial_group_id = 0;
+        serial_valid = false;
         src_item.clear();
         dst_item.clear();
         decode_timer_list.clear();
+        report = receive_report_t();
+        buffered_bytes = 0;
+        transit_valid = false;
+        transit_base = 0;
+        transit_delta = 0.0;
+        jitter = 0.0;
     }
 };
 
@@ -240,528 +736,2855 @@ static void get_current_time(uint32_t & seconds, uint32_t & microseconds)
 #endif // _MSC_VER
 }
 
-static bool create_original_blocks(CM256::cm256_block * blocks, std::list<std::vector<uint8_t>> & original_blocks, block_head_t & block_head, block_body_t & block_body, const uint8_t *& data, uint32_t & size, encode_callback_t encode_callback, void * user_data)
+/*
+ * log-linear buckets: values below 16 have one bucket each, every power of two above has 16, about 6% apart
+ */
+uint32_t latency_histogram_t::bucket_index(uint64_t value)
 {
-    const uint32_t block_size = static_cast<uint32_t>(sizeof(block_t) + block_body.block_bytes);
-
-    for (uint8_t block_id = 0; block_id < block_head.original_count; ++block_id)
+    if (value < sub_bucket_count)
     {
-        std::vector<uint8_t> original_buffer(block_size, 0x0);
-
-        block_t * block = reinterpret_cast<block_t *>(&original_buffer[0]);
+        return static_cast<uint32_t>(value);
+    }
 
-        block->head.group_id = block_head.group_id;
-        block->head.protocol = s_protocol;
-        block->head.block_id = block_id;
-        block->head.original_count = block_head.original_count;
-        block->head.recovery_count = block_head.recovery_count;
+    uint32_t exponent = 4;
+    while (exponent < 36 && (value >> (exponent + 1)) != 0)
+    {
+        ++exponent;
+    }
+    if (exponent >= 36)
+    {
+        return bucket_count - 1;
+    }
 
-        block->body.block_index = block_body.block_index++;
-        block->body.block_bytes = std::min<uint32_t>(size, block_body.block_bytes);
-        block->body.frame_size = block_body.frame_size;
-        block->body.frame_index = block_body.frame_index;
-        block->body.frame_count = block_body.frame_count;
+    return sub_bucket_count + (exponent - 4) * sub_bucket_count + static_cast<uint32_t>((value >> (exponent - 4)) & (sub_bucket_count - 1));
+}
 
-        if (0 != block->body.block_bytes)
-        {
-            memcpy(&original_buffer[sizeof(block_t)], data, block->body.block_bytes);
-            data += block->body.block_bytes;
-            size -= block->body.block_bytes;
-        }
+uint64_t latency_histogram_t::bucket_value(uint32_t bucket)
+{
+    if (bucket < sub_bucket_count)
+    {
+        return bucket;
+    }
 
-        block->head.encode();
-        block->body.encode();
+    const uint32_t exponent = (bucket - sub_bucket_count) / sub_bucket_count + 4;
+    const uint32_t sub_bucket = (bucket - sub_bucket_count) % sub_bucket_count;
+    return static_cast<uint64_t>(sub_bucket_count + sub_bucket) << (exponent - 4);
+}
 
-        blocks[block_id].Block = &block->body;
-        blocks[block_id].Index = block_id;
+void latency_histogram_t::record(uint64_t value)
+{
+    counts[bucket_index(value)] += 1;
+    min_value = (0 == total_count ? value : std::min<uint64_t>(min_value, value));
+    max_value = std::max<uint64_t>(max_value, value);
+    total_count += 1;
+    sum += value;
+}
 
-        if (nullptr != encode_callback)
-        {
-            (*encode_callback)(user_data, &original_buffer[0], static_cast<uint32_t>(original_buffer.size()));
-        }
-        else
-        {
-            original_blocks.emplace_back(std::move(original_buffer));
-        }
+void latency_histogram_t::merge(const latency_histogram_t & other)
+{
+    if (0 == other.total_count)
+    {
+        return;
     }
 
-    return true;
+    for (uint32_t bucket = 0; bucket < bucket_count; ++bucket)
+    {
+        counts[bucket] += other.counts[bucket];
+    }
+    min_value = (0 == total_count ? other.min_value : std::min<uint64_t>(min_value, other.min_value));
+    max_value = std::max<uint64_t>(max_value, other.max_value);
+    total_count += other.total_count;
+    sum += other.sum;
 }
 
-static bool create_recovery_blocks(CM256::cm256_block * blocks, std::list<std::vector<uint8_t>> & recovery_blocks, const block_head_t & block_head, const block_body_t & block_body, encode_callback_t encode_callback, void * user_data)
+/*
+ * the highest value of the bucket that holds the sample of the given rank, kept within min_value and max_value
+ */
+uint64_t latency_histogram_t::percentile(double rank) const
 {
-    if (0 == block_head.recovery_count)
+    if (0 == total_count)
     {
-        return true;
+        return 0;
     }
 
-    uint8_t * recovery_data[256] = { 0x0 };
-
-    const uint32_t block_size = static_cast<uint32_t>(sizeof(block_t) + block_body.block_bytes);
+    const double clamped_rank = std::max<double>(std::min<double>(rank, 1.0), 0.0);
+    const uint64_t target = std::max<uint64_t>(static_cast<uint64_t>(ceil(clamped_rank * static_cast<double>(total_count))), 1);
 
-    for (uint8_t block_id = 0; block_id < block_head.recovery_count; ++block_id)
+    uint64_t count = 0;
+    for (uint32_t bucket = 0; bucket < bucket_count; ++bucket)
     {
-        std::vector<uint8_t> recovery_buffer(block_size, 0x0);
-
-        block_t * block = reinterpret_cast<block_t *>(&recovery_buffer[0]);
+        count += counts[bucket];
+        if (count >= target)
+        {
+            const uint64_t highest_value = (bucket + 1 < bucket_count ? bucket_value(bucket + 1) - 1 : max_value);
+            return std::max<uint64_t>(std::min<uint64_t>(highest_value, max_value), min_value);
+        }
+    }
 
-        block->head.group_id = block_head.group_id;
-        block->head.protocol = s_protocol;
-        block->head.block_id = block_head.original_count + block_id;
-        block->head.original_count = block_head.original_count;
-        block->head.recovery_count = block_head.recovery_count;
+    return max_value;
+}
 
-        block->head.encode();
+static uint64_t get_steady_nanoseconds()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
 
-        blocks[block_head.original_count + block_id].Block = &block->body;
-        blocks[block_head.original_count + block_id].Index = block_head.original_count + block_id;
+static uint32_t get_current_timestamp()
+{
+    uint32_t seconds = 0;
+    uint32_t microseconds = 0;
+    get_current_time(seconds, microseconds);
+    return static_cast<uint32_t>(static_cast<uint64_t>(seconds) * 1000 + microseconds / 1000);
+}
 
-        recovery_data[block_id] = reinterpret_cast<uint8_t *>(&block->body);
+struct group_plan_t
+{
+    uint32_t                            frame_offset;
+    uint32_t                            frame_bytes;
+    uint8_t                             original_count;
+    uint8_t                             recovery_count;
+};
 
-        if (nullptr != encode_callback)
-        {
-            (*encode_callback)(user_data, &recovery_buffer[0], static_cast<uint32_t>(recovery_buffer.size()));
-        }
-        else
-        {
-            recovery_blocks.emplace_back(std::move(recovery_buffer));
-        }
-    }
+struct frame_plan_t
+{
+    uint32_t                            block_bytes;
+    std::vector<group_plan_t>           group_plans;
+};
 
-    CM256 cm256;
-    if (!cm256.isInitialized())
+static void make_encode_format(const encode_option_t & option, block_format_t & block_format)
+{
+    if (2 == option.header_version)
     {
-        return false;
+        make_block_format(s_compact_protocol, (24 == option.group_id_bits ? s_compact_flag_wide_group_id : 0) | (option.send_timestamp ? s_compact_flag_timestamp : 0), block_format);
     }
-
-    CM256::cm256_encoder_params params = { block_head.original_count, block_head.recovery_count, static_cast<int>(sizeof(block_body_t) + block_body.block_bytes) };
-    if (0 != cm256.cm256_encode(params, blocks, recovery_data))
+    else
     {
-        return false;
+        make_block_format(s_protocol, 0, block_format);
     }
+}
 
-    return true;
+static uint8_t max_original_count(double recovery_rate)
+{
+    return static_cast<uint8_t>(255.0 * (1.0 - recovery_rate) + 0.5);
 }
 
-static bool cm256_encode(const uint8_t * src_data, uint32_t src_size, uint32_t max_block_size, double recovery_rate, bool force_recovery, uint64_t & group_id, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+static uint8_t group_original_count(const encode_option_t & option)
 {
-    if (nullptr == src_data || 0 == src_size)
-    {
-        return false;
-    }
+    return std::max<uint8_t>(std::min<uint8_t>(max_original_count(option.recovery_rate), option.max_original_count), 1);
+}
+
+static uint8_t plan_recovery_count(uint32_t original_count, const encode_option_t & option)
+{
+    const uint8_t full_original_count = max_original_count(option.recovery_rate);
 
-    if (recovery_rate < 0.0 || recovery_rate >= 1.0)
+    uint8_t recovery_count = 0;
+    if (original_count >= full_original_count)
     {
-        return false;
+        recovery_count = static_cast<uint8_t>(255 - full_original_count);
     }
-
-    if (max_block_size <= sizeof(block_t))
+    else
     {
-        return false;
+        recovery_count = static_cast<uint8_t>(static_cast<double>(original_count) * option.recovery_rate / (1.0 - option.recovery_rate) + 0.5);
+    }
+    if (option.force_recovery && option.recovery_rate > 0.0 && 0 == recovery_count)
+    {
+        recovery_count = 1;
     }
 
-    uint8_t original_count = static_cast<uint8_t>(255.0 * (1.0 - recovery_rate) + 0.5);
-    uint8_t recovery_count = static_cast<uint8_t>(255 - original_count);
+    return recovery_count;
+}
+
+static bool plan_standard_frame(uint32_t frame_size, const encode_option_t & option, frame_plan_t & frame_plan)
+{
+    const uint32_t payload_bytes = std::min<uint32_t>(static_cast<uint32_t>(option.max_block_size - sizeof(block_t)), frame_size);
+    const uint8_t full_original_count = group_original_count(option);
 
-    uint32_t block_bytes = static_cast<uint32_t>(max_block_size - sizeof(block_t));
-    uint32_t block_count = (src_size + block_bytes - 1) / block_bytes;
+    frame_plan.block_bytes = static_cast<uint32_t>(sizeof(block_body_t) + payload_bytes);
+    frame_plan.group_plans.clear();
 
-    block_body_t block_body = { 0x0 };
-    block_body.block_index = 0;
-    block_body.block_bytes = block_bytes;
-    block_body.frame_size = src_size;
-    block_body.frame_index = 0;
-    block_body.frame_count = static_cast<uint16_t>((block_count + original_count - 1) / original_count);
+    uint32_t block_count = (frame_size + payload_bytes - 1) / payload_bytes;
+    uint32_t frame_offset = 0;
 
     while (0 != block_count)
     {
-        if (original_count > block_count)
-        {
-            original_count = static_cast<uint8_t>(block_count);
-            if (recovery_rate >= 1.0)
-            {
-                recovery_count = static_cast<uint8_t>(255 - block_count);
-            }
-            else
-            {
-                recovery_count = static_cast<uint8_t>(static_cast<double>(block_count) * recovery_rate / (1.0 - recovery_rate) + 0.5);
-            }
-        }
-        if (force_recovery && recovery_rate > 0.0 && 0 == recovery_count)
-        {
-            recovery_count = 1;
-        }
-        block_count -= original_count;
+        group_plan_t group_plan = { 0x0 };
+        group_plan.original_count = static_cast<uint8_t>(std::min<uint32_t>(block_count, full_original_count));
+        group_plan.recovery_count = plan_recovery_count(group_plan.original_count, option);
+        group_plan.frame_offset = frame_offset;
+        group_plan.frame_bytes = static_cast<uint32_t>(std::min<uint64_t>(frame_size - frame_offset, static_cast<uint64_t>(group_plan.original_count) * payload_bytes));
+        frame_plan.group_plans.push_back(group_plan);
+
+        block_count -= group_plan.original_count;
+        frame_offset += group_plan.frame_bytes;
+    }
 
-        block_head_t block_head = { 0x0 };
-        block_head.group_id = group_id;
-        block_head.original_count = original_count;
-        block_head.recovery_count = recovery_count;
+    return frame_plan.group_plans.size() <= 0xffff;
+}
 
-        CM256::cm256_block blocks[256];
+/*
+ * plan the groups of the frame bytes [segment_offset, segment_offset + segment_size),
+ * its first group is group frame_index of the frame, frame_count only has to have the right varint width
+ */
+static bool plan_compact_segment(uint32_t frame_size, uint32_t segment_offset, uint32_t segment_size, uint32_t frame_index, uint32_t frame_count, const encode_option_t & option, const block_format_t & block_format, frame_plan_t & frame_plan)
+{
+    const uint32_t max_block_bytes = option.max_block_size - block_format.head_size;
+    const uint8_t full_original_count = group_original_count(option);
+    const uint32_t segment_end = segment_offset + segment_size;
 
-        std::list<std::vector<uint8_t>> original_blocks;
-        if (!create_original_blocks(blocks, original_blocks, block_head, block_body, src_data, src_size, encode_callback, user_data))
-        {
-            return false;
-        }
+    record_head_t record_head = { frame_size, segment_offset, frame_index, frame_count, segment_size };
 
-        std::list<std::vector<uint8_t>> recovery_blocks;
-        if (!create_recovery_blocks(blocks, recovery_blocks, block_head, block_body, encode_callback, user_data))
+    frame_plan.block_bytes = std::min<uint32_t>(max_block_bytes, record_head.size() + segment_size);
+    frame_plan.group_plans.clear();
+
+    uint32_t frame_offset = segment_offset;
+    while (frame_offset < segment_end)
+    {
+        record_head.frame_offset = frame_offset;
+        record_head.frame_index = frame_index + static_cast<uint32_t>(frame_plan.group_plans.size());
+        record_head.bytes = segment_end - frame_offset;
+
+        const uint64_t group_bytes = static_cast<uint64_t>(full_original_count) * frame_plan.block_bytes;
+        if (group_bytes <= record_head.size())
         {
             return false;
         }
 
-        dst_list.splice(dst_list.end(), original_blocks);
-        dst_list.splice(dst_list.end(), recovery_blocks);
+        group_plan_t group_plan = { 0x0 };
+        group_plan.frame_offset = frame_offset;
+        group_plan.frame_bytes = static_cast<uint32_t>(std::min<uint64_t>(record_head.bytes, group_bytes - record_head.size()));
+        group_plan.original_count = static_cast<uint8_t>((record_head.size() + group_plan.frame_bytes + frame_plan.block_bytes - 1) / frame_plan.block_bytes);
+        group_plan.recovery_count = plan_recovery_count(group_plan.original_count, option);
+        frame_plan.group_plans.push_back(group_plan);
 
-        ++group_id;
-        ++block_body.frame_index;
+        frame_offset += group_plan.frame_bytes;
     }
 
-    return true;
+    return frame_plan.group_plans.size() <= 0xffff;
 }
 
-static bool insert_group_block(const void * data, uint32_t size, groups_t & groups, uint32_t max_delay_microseconds)
+static bool plan_compact_frame(uint32_t frame_size, const encode_option_t & option, const block_format_t & block_format, frame_plan_t & frame_plan)
 {
-    const uint32_t new_block_size = static_cast<uint32_t>(size);
-    if (size < sizeof(block_t))
+    /* records carry frame_count, so plan again until its varint width settles */
+    uint32_t frame_count = 1;
+    while (true)
     {
-        return false;
+        if (!plan_compact_segment(frame_size, 0, frame_size, 0, frame_count, option, block_format, frame_plan))
+        {
+            return false;
+        }
+
+        const uint32_t group_count = static_cast<uint32_t>(frame_plan.group_plans.size());
+        if (varint_size(group_count) == varint_size(frame_count))
+        {
+            return true;
+        }
+        frame_count = group_count;
     }
+}
 
-    block_head_t new_block_head = *reinterpret_cast<const block_head_t *>(data);
-    new_block_head.decode();
+static bool greater_remainder(const std::pair<uint64_t, uint32_t> & lhs, const std::pair<uint64_t, uint32_t> & rhs)
+{
+    return lhs.first > rhs.first;
+}
 
-    if (s_protocol != new_block_head.protocol || 0 == new_block_head.original_count || new_block_head.block_id >= new_block_head.original_count + new_block_head.recovery_count)
+static void distribute_recovery_count(std::vector<group_plan_t> & group_plans, uint32_t recovery_count, const encode_option_t & option)
+{
+    uint32_t original_count = 0;
+    for (std::vector<group_plan_t>::const_iterator iter = group_plans.begin(); group_plans.end() != iter; ++iter)
     {
-        return false;
+        original_count += iter->original_count;
     }
 
-    if (new_block_head.block_id < new_block_head.original_count)
+    /* largest remainder method, so that the recovery blocks of the frame stay exactly the same */
+    std::vector<std::pair<uint64_t, uint32_t>> remainders;
+    uint32_t assigned_count = 0;
+    for (uint32_t index = 0; index < group_plans.size(); ++index)
     {
-        block_body_t new_block_body = *reinterpret_cast<const block_body_t *>(reinterpret_cast<const uint8_t *>(data) + sizeof(block_head_t));
-        new_block_body.decode();
+        const uint64_t share = static_cast<uint64_t>(recovery_count) * group_plans[index].original_count;
+        group_plans[index].recovery_count = static_cast<uint8_t>(share / original_count);
+        assigned_count += group_plans[index].recovery_count;
+        remainders.push_back(std::make_pair(share % original_count, index));
+    }
+    std::stable_sort(remainders.begin(), remainders.end(), greater_remainder);
+    for (uint32_t index = 0; assigned_count < recovery_count && index < remainders.size(); ++index, ++assigned_count)
+    {
+        group_plans[remainders[index].second].recovery_count += 1;
+    }
 
-        if (0 == new_block_body.frame_count || new_block_body.frame_index >= new_block_body.frame_count || sizeof(block_t) + new_block_body.block_bytes > size)
+    for (std::vector<group_plan_t>::iterator iter = group_plans.begin(); group_plans.end() != iter; ++iter)
+    {
+        iter->recovery_count = static_cast<uint8_t>(std::min<uint32_t>(iter->recovery_count, 256 - iter->original_count));
+        if (option.force_recovery && option.recovery_rate > 0.0 && 0 == iter->recovery_count && iter->original_count < 256)
         {
-            return false;
+            iter->recovery_count = 1;
         }
     }
+}
 
-    if (new_block_head.group_id < groups.min_group_id)
+/*
+ * split the frame into groups of near equal size instead of full groups and a small rest,
+ * the groups and the recovery blocks of the greedy plan are kept, only spread evenly
+ */
+static void balance_frame_plan(uint32_t frame_size, const encode_option_t & option, const block_format_t & block_format, frame_plan_t & frame_plan)
+{
+    const uint32_t group_count = static_cast<uint32_t>(frame_plan.group_plans.size());
+    if (group_count < 2)
     {
-        return false;
+        return;
     }
 
-    groups.new_group_id = new_block_head.group_id;
+    uint32_t original_count = 0;
+    uint32_t recovery_count = 0;
+    for (std::vector<group_plan_t>::const_iterator iter = frame_plan.group_plans.begin(); frame_plan.group_plans.end() != iter; ++iter)
+    {
+        original_count += iter->original_count;
+        recovery_count += iter->recovery_count;
+    }
 
-    group_src_t & group_src = groups.src_item[groups.new_group_id];
-    group_head_t & group_head = group_src.head;
-    group_body_t & group_body = group_src.body;
+    const uint8_t full_original_count = group_original_count(option);
 
-    if (0 == group_head.block_count)
+    std::vector<group_plan_t> group_plans;
+    uint32_t frame_offset = 0;
+
+    for (uint32_t frame_index = 0; frame_index < group_count; ++frame_index)
     {
-        if (0 == group_head.original_count || 
-            new_block_size != group_head.block_size ||
-            new_block_head.group_id != group_head.group_id ||
-            new_block_head.original_count != group_head.original_count || new_block_head.recovery_count != group_head.recovery_count)
+        group_plan_t group_plan = { 0x0 };
+        group_plan.frame_offset = frame_offset;
+
+        if (s_compact_protocol == block_format.protocol)
         {
-            group_head.block_size = new_block_size;
-            group_head.group_id = new_block_head.group_id;
-            group_head.original_count = new_block_head.original_count;
-            group_head.recovery_count = new_block_head.recovery_count;
-            memset(group_head.block_bitmap, 0x0, sizeof(group_head.block_bitmap));
-            group_head.block_bitmap[new_block_head.block_id >> 3] |= (1 << (new_block_head.block_id & 7));
-            if (new_block_head.block_id < new_block_head.original_count)
-            {
-                group_body.original_list.emplace_back(std::vector<uint8_t>(reinterpret_cast<const uint8_t *>(data), reinterpret_cast<const uint8_t *>(data) + size));
-                memcpy(&group_body.original_list.back()[0], &new_block_head, sizeof(new_block_head));
-            }
-            else
+            group_plan.frame_bytes = frame_size / group_count + (frame_index < frame_size % group_count ? 1 : 0);
+            const record_head_t record_head = { frame_size, frame_offset, frame_index, group_count, group_plan.frame_bytes };
+            const uint32_t block_count = (record_head.size() + group_plan.frame_bytes + frame_plan.block_bytes - 1) / frame_plan.block_bytes;
+            if (block_count > full_original_count)
             {
-                group_body.recovery_list.emplace_back(std::vector<uint8_t>(reinterpret_cast<const uint8_t *>(data), reinterpret_cast<const uint8_t *>(data) + size));
-                memcpy(&group_body.recovery_list.back()[0], &new_block_head, sizeof(new_block_head));
+                return;
             }
-            group_head.block_count += 1;
+            group_plan.original_count = static_cast<uint8_t>(block_count);
+        }
+        else
+        {
+            const uint32_t payload_bytes = static_cast<uint32_t>(frame_plan.block_bytes - sizeof(block_body_t));
+            group_plan.original_count = static_cast<uint8_t>(original_count / group_count + (frame_index < original_count % group_count ? 1 : 0));
+            group_plan.frame_bytes = static_cast<uint32_t>(std::min<uint64_t>(frame_size - frame_offset, static_cast<uint64_t>(group_plan.original_count) * payload_bytes));
+        }
 
-            decode_timer_t decode_timer = { 0x0 };
-            decode_timer.group_id = new_block_head.group_id;
-            get_current_time(decode_timer.decode_seconds, decode_timer.decode_microseconds);
-            decode_timer.decode_microseconds += max_delay_microseconds * (group_head.original_count > 100 ? 2 : 1);
-            decode_timer.decode_seconds += decode_timer.decode_microseconds / 1000000;
-            decode_timer.decode_microseconds %= 1000000;
+        group_plans.push_back(group_plan);
+        frame_offset += group_plan.frame_bytes;
+    }
 
-            groups.decode_timer_list.push_back(decode_timer);
+    if (frame_offset != frame_size)
+    {
+        return;
+    }
 
-            return true;
-        }
-        else
+    distribute_recovery_count(group_plans, recovery_count, option);
+
+    frame_plan.group_plans.swap(group_plans);
+}
+
+static bool plan_frame(uint32_t frame_size, const encode_option_t & option, const block_format_t & block_format, frame_plan_t & frame_plan)
+{
+    if (s_compact_protocol == block_format.protocol)
+    {
+        if (!plan_compact_frame(frame_size, option, block_format, frame_plan))
         {
             return false;
         }
     }
     else
     {
-        if (new_block_size != group_head.block_size ||
-            new_block_head.group_id != group_head.group_id ||
-            new_block_head.original_count != group_head.original_count || new_block_head.recovery_count != group_head.recovery_count)
+        if (!plan_standard_frame(frame_size, option, frame_plan))
         {
             return false;
         }
+    }
 
-        if (group_head.block_bitmap[new_block_head.block_id >> 3] & (1 << (new_block_head.block_id & 7)))
-        {
-            return false;
-        }
+    if (option.balanced_groups)
+    {
+        balance_frame_plan(frame_size, option, block_format, frame_plan);
     }
 
-    if (group_head.block_count == group_head.original_count)
+    return true;
+}
+
+static void count_frame_plan(const frame_plan_t & frame_plan, uint32_t & original_count, uint32_t & recovery_count)
+{
+    original_count = 0;
+    recovery_count = 0;
+    for (std::vector<group_plan_t>::const_iterator iter = frame_plan.group_plans.begin(); frame_plan.group_plans.end() != iter; ++iter)
     {
-        if (new_block_head.block_id < new_block_head.original_count)
-        {
-            block_head_t * old_block_head = reinterpret_cast<block_head_t *>(&group_body.recovery_list.back()[0]);
-            group_head.block_bitmap[old_block_head->block_id >> 3] &= ~(1 << (old_block_head->block_id & 7));
-            group_body.recovery_list.pop_back();
-            group_head.block_bitmap[new_block_head.block_id >> 3] |= (1 << (new_block_head.block_id & 7));
-            group_body.original_list.emplace_back(std::vector<uint8_t>(reinterpret_cast<const uint8_t *>(data), reinterpret_cast<const uint8_t *>(data) + size));
-            memcpy(&group_body.original_list.back()[0], &new_block_head, sizeof(new_block_head));
-        }
+        original_count += iter->original_count;
+        recovery_count += iter->recovery_count;
     }
-    else
+}
+
+static uint64_t frame_plan_bytes(uint32_t frame_size, const frame_plan_t & frame_plan, uint32_t frame_index_base, uint32_t frame_count, const encode_option_t & option, const block_format_t & block_format)
+{
+    uint32_t original_count = 0;
+    uint32_t recovery_count = 0;
+    count_frame_plan(frame_plan, original_count, recovery_count);
+
+    uint64_t bytes = static_cast<uint64_t>(original_count + recovery_count) * (block_format.head_size + frame_plan.block_bytes);
+
+    if (option.shorten_last_block)
     {
-        group_head.block_bitmap[new_block_head.block_id >> 3] |= (1 << (new_block_head.block_id & 7));
-        if (new_block_head.block_id < new_block_head.original_count)
-        {
-            group_body.original_list.emplace_back(std::vector<uint8_t>(reinterpret_cast<const uint8_t *>(data), reinterpret_cast<const uint8_t *>(data) + size));
-            memcpy(&group_body.original_list.back()[0], &new_block_head, sizeof(new_block_head));
-        }
-        else
+        const uint32_t group_count = static_cast<uint32_t>(frame_plan.group_plans.size());
+        for (uint32_t group_index = 0; group_index < group_count; ++group_index)
         {
-            group_body.recovery_list.emplace_back(std::vector<uint8_t>(reinterpret_cast<const uint8_t *>(data), reinterpret_cast<const uint8_t *>(data) + size));
-            memcpy(&group_body.recovery_list.back()[0], &new_block_head, sizeof(new_block_head));
+            const group_plan_t & group_plan = frame_plan.group_plans[group_index];
+            const uint64_t group_bytes = static_cast<uint64_t>(group_plan.original_count) * frame_plan.block_bytes;
+            if (s_compact_protocol == block_format.protocol)
+            {
+                const record_head_t record_head = { frame_size, group_plan.frame_offset, frame_index_base + group_index, frame_count, group_plan.frame_bytes };
+                bytes -= group_bytes - record_head.size() - group_plan.frame_bytes;
+            }
+            else
+            {
+                bytes -= group_bytes - static_cast<uint64_t>(group_plan.original_count) * sizeof(block_body_t) - group_plan.frame_bytes;
+            }
         }
-        group_head.block_count += 1;
     }
 
-    return true;
+    return bytes;
 }
 
-static bool cm256_decode_group(group_head_t & group_head, group_body_t & group_body, groups_t & groups, uint64_t & min_group_id, uint64_t & max_group_id)
+static uint64_t frame_plan_bytes(uint32_t frame_size, const frame_plan_t & frame_plan, const encode_option_t & option, const block_format_t & block_format)
 {
-    min_group_id = 0;
-    max_group_id = 0;
+    return frame_plan_bytes(frame_size, frame_plan, 0, static_cast<uint32_t>(frame_plan.group_plans.size()), option, block_format);
+}
 
-    if (group_body.original_list.size() + group_body.recovery_list.size() != group_head.original_count)
+/*
+ * shrink the blocks so that the padding of the last original block is not paid again by every recovery block,
+ * the padding is below one block, so a few block counts above the minimum (s_adaptive_block_counts, at most twice the minimum)
+ * are tried and the fewest wire bytes win, a plan is only taken if its share of recovery blocks is not below the one of the minimum block count
+ */
+static bool plan_adaptive_frame(uint32_t frame_size, const encode_option_t & option, const block_format_t & block_format, frame_plan_t & frame_plan)
+{
+    if (!plan_frame(frame_size, option, block_format, frame_plan))
     {
         return false;
     }
 
-    std::list<std::vector<uint8_t>> src_data_list;
-    src_data_list.splice(src_data_list.end(), group_body.original_list);
+    uint32_t min_original_count = 0;
+    uint32_t min_recovery_count = 0;
+    count_frame_plan(frame_plan, min_original_count, min_recovery_count);
 
-    if (!group_body.recovery_list.empty())
-    {
-        src_data_list.splice(src_data_list.end(), group_body.recovery_list);
+    const record_head_t record_head = { frame_size, 0, 0, 1, frame_size };
+    const uint32_t stream_size = (s_compact_protocol == block_format.protocol ? record_head.size() + frame_size : frame_size);
+    const uint32_t stream_head = (s_compact_protocol == block_format.protocol ? block_format.head_size : static_cast<uint32_t>(sizeof(block_t)));
 
-        CM256::cm256_block blocks[256];
+    uint64_t best_bytes = frame_plan_bytes(frame_size, frame_plan, option, block_format);
+    uint32_t last_block_size = option.max_block_size;
+
+    encode_option_t adaptive_option = option;
+    frame_plan_t adaptive_plan;
 
-        uint32_t block_id = 0;
-        for (std::list<std::vector<uint8_t>>::iterator iter = src_data_list.begin(); src_data_list.end() != iter; ++iter)
+    const uint32_t max_block_count = std::min<uint32_t>(min_original_count * 2, min_original_count + s_adaptive_block_counts);
+    for (uint32_t block_count = min_original_count; block_count <= max_block_count && block_count <= stream_size; ++block_count)
+    {
+        adaptive_option.max_block_size = std::min<uint32_t>(option.max_block_size, stream_head + (stream_size + block_count - 1) / block_count);
+        if (adaptive_option.max_block_size == last_block_size || adaptive_option.max_block_size <= stream_head)
         {
-            std::vector<uint8_t> & data = *iter;
-            block_t * block = reinterpret_cast<block_t *>(&data[0]);
-            blocks[block_id].Block = &block->body;
-            blocks[block_id].Index = block->head.block_id;
-            ++block_id;
+            continue;
         }
+        last_block_size = adaptive_option.max_block_size;
 
-        CM256 cm256;
-        if (!cm256.isInitialized())
+        if (!plan_frame(frame_size, adaptive_option, block_format, adaptive_plan))
         {
-            return false;
+            continue;
         }
 
-        CM256::cm256_encoder_params params = { group_head.original_count, group_head.recovery_count, static_cast<int>(group_head.block_size - sizeof(block_head_t)) };
-        if (0 != cm256.cm256_decode(params, blocks))
+        uint32_t original_count = 0;
+        uint32_t recovery_count = 0;
+        count_frame_plan(adaptive_plan, original_count, recovery_count);
+        if (static_cast<uint64_t>(recovery_count) * (min_original_count + min_recovery_count) < static_cast<uint64_t>(min_recovery_count) * (original_count + recovery_count))
         {
-            return false;
+            continue;
         }
-    }
 
-    if (src_data_list.empty())
-    {
-        return false;
+        const uint64_t adaptive_bytes = frame_plan_bytes(frame_size, adaptive_plan, option, block_format);
+        if (adaptive_bytes < best_bytes)
+        {
+            best_bytes = adaptive_bytes;
+            frame_plan.block_bytes = adaptive_plan.block_bytes;
+            frame_plan.group_plans.swap(adaptive_plan.group_plans);
+        }
     }
 
-    block_t block = *reinterpret_cast<block_t *>(&src_data_list.front()[0]);
-    block.body.decode();
+    return true;
+}
 
-    if (0 == block.body.frame_count || group_head.group_id < block.body.frame_index)
+struct protect_segment_t
+{
+    uint32_t                            offset;
+    uint32_t                            size;
+    double                              recovery_rate;
+    uint32_t                            frame_index;
+    frame_plan_t                        frame_plan;
+
+    protect_segment_t()
+        : offset(0)
+        , size(0)
+        , recovery_rate(0.0)
+        , frame_index(0)
+        , frame_plan()
     {
-        return false;
+
     }
+};
 
-    min_group_id = group_head.group_id - block.body.frame_index;
-    max_group_id = min_group_id + block.body.frame_count;
+static bool less_protect_range(const protect_range_t & lhs, const protect_range_t & rhs)
+{
+    return lhs.offset < rhs.offset;
+}
 
-    group_dst_t & group_dst = groups.dst_item[max_group_id - 1];
-    group_dst.min_group_id = min_group_id;
-    group_dst.max_group_id = max_group_id;
-    group_dst.group_status.resize(static_cast<uint32_t>(max_group_id - min_group_id));
-    std::vector<uint8_t> & dst_data = group_dst.data;
+/*
+ * cut the frame into segments of one recovery rate each, the bytes outside the protect ranges keep the frame rate
+ */
+static bool make_protect_segments(uint32_t frame_size, double recovery_rate, const std::vector<protect_range_t> & protect_ranges, std::vector<protect_segment_t> & protect_segments)
+{
+    std::vector<protect_range_t> ranges(protect_ranges);
+    std::sort(ranges.begin(), ranges.end(), less_protect_range);
 
-    group_dst.group_status[block.body.frame_index] = false;
+    protect_segments.clear();
 
-    for (std::list<std::vector<uint8_t>>::iterator iter = src_data_list.begin(); src_data_list.end() != iter; ++iter)
+    uint32_t frame_offset = 0;
+    for (std::vector<protect_range_t>::const_iterator iter = ranges.begin(); ranges.end() != iter; ++iter)
     {
-        std::vector<uint8_t> & data = *iter;
-        block_body_t * block_body = reinterpret_cast<block_body_t *>(&data[sizeof(block_head_t)]);
-        block_body->decode();
-        if (block_body->frame_index >= block_body->frame_count || block_body->block_index >= group_head.block_count || block.body.frame_size != block_body->frame_size)
+        if (iter->offset < frame_offset || iter->size > frame_size - iter->offset || iter->recovery_rate < 0.0 || iter->recovery_rate >= 1.0)
         {
-            dst_data.clear();
             return false;
         }
-        if (dst_data.empty())
+
+        protect_segment_t segment;
+        if (iter->offset > frame_offset)
         {
-            dst_data.resize(block_body->frame_size);
+            segment.offset = frame_offset;
+            segment.size = iter->offset - frame_offset;
+            segment.recovery_rate = recovery_rate;
+            protect_segments.push_back(segment);
         }
-        if (dst_data.size() != block_body->frame_size)
+        if (0 != iter->size)
         {
-            dst_data.clear();
-            return false;
+            segment.offset = iter->offset;
+            segment.size = iter->size;
+            segment.recovery_rate = iter->recovery_rate;
+            protect_segments.push_back(segment);
         }
-        memcpy(&dst_data[block_body->block_index * (data.size() - sizeof(block_t))], &data[sizeof(block_t)], block_body->block_bytes);
+        frame_offset = iter->offset + iter->size;
+    }
+
+    if (frame_offset < frame_size)
+    {
+        protect_segment_t segment;
+        segment.offset = frame_offset;
+        segment.size = frame_size - frame_offset;
+        segment.recovery_rate = recovery_rate;
+        protect_segments.push_back(segment);
     }
 
-    group_dst.group_status[block.body.frame_index] = true;
+    /* neighbours of one rate are planned as one segment */
+    std::vector<protect_segment_t>::iterator iter = protect_segments.begin();
+    while (protect_segments.end() != iter)
+    {
+        std::vector<protect_segment_t>::iterator next = iter + 1;
+        if (protect_segments.end() != next && next->recovery_rate == iter->recovery_rate)
+        {
+            iter->size += next->size;
+            iter = protect_segments.erase(next) - 1;
+        }
+        else
+        {
+            iter = next;
+        }
+    }
 
     return true;
 }
 
-static void remove_expired_blocks(groups_t & groups)
+/*
+ * every segment is planned with its own rate and block size, the groups of all segments count as groups of one frame
+ */
+static bool plan_protected_frame(uint32_t frame_size, const encode_option_t & option, const block_format_t & block_format, std::vector<protect_segment_t> & protect_segments, uint32_t & frame_count)
 {
-    std::map<uint64_t, group_src_t> & src_item = groups.src_item;
-    for (std::map<uint64_t, group_src_t>::iterator iter = src_item.begin(); src_item.end() != iter; iter = src_item.erase(iter))
+    encode_option_t segment_option = option;
+
+    frame_count = 1;
+    while (true)
     {
-        if (iter->first >= groups.min_group_id)
+        uint32_t group_count = 0;
+        for (std::vector<protect_segment_t>::iterator iter = protect_segments.begin(); protect_segments.end() != iter; ++iter)
         {
-            break;
+            segment_option.recovery_rate = iter->recovery_rate;
+            iter->frame_index = group_count;
+            if (!plan_compact_segment(frame_size, iter->offset, iter->size, group_count, frame_count, segment_option, block_format, iter->frame_plan))
+            {
+                return false;
+            }
+            group_count += static_cast<uint32_t>(iter->frame_plan.group_plans.size());
         }
-    }
 
-    std::map<uint64_t, group_dst_t> & dst_item = groups.dst_item;
-    for (std::map<uint64_t, group_dst_t>::iterator iter = dst_item.begin(); dst_item.end() != iter; iter = dst_item.erase(iter))
-    {
-        if (iter->first >= groups.min_group_id)
+        if (group_count > 0xffff)
         {
-            break;
+            return false;
         }
+        if (varint_size(group_count) == varint_size(frame_count))
+        {
+            frame_count = group_count;
+            return true;
+        }
+        frame_count = group_count;
     }
 }
 
-static bool check_package(const uint8_t * data, uint32_t size)
+static void write_block_head(uint8_t * data, const block_format_t & block_format, const block_head_t & block_head)
 {
-    if (nullptr == data || size < sizeof(block_t))
+    if (s_compact_protocol == block_format.protocol)
     {
-        return false;
+        *data++ = s_compact_protocol;
+        *data++ = block_format.flags;
+        for (uint32_t bits = block_format.group_id_bits; 0 != bits; bits -= 8)
+        {
+            *data++ = static_cast<uint8_t>(block_head.group_id >> (bits - 8));
+        }
+        *data++ = block_head.block_id;
+        *data++ = block_head.original_count;
+        *data++ = block_head.recovery_count;
+        if (0 != (block_format.flags & s_compact_flag_timestamp))
+        {
+            for (uint32_t bits = 32; 0 != bits; bits -= 8)
+            {
+                *data++ = static_cast<uint8_t>(block_format.timestamp >> (bits - 8));
+            }
+            *data++ = static_cast<uint8_t>(block_format.duration >> 8);
+            *data++ = static_cast<uint8_t>(block_format.duration);
+        }
     }
-
-    block_head_t block_head = *reinterpret_cast<const block_head_t *>(data);
-    block_head.decode();
-
-    if (s_protocol != block_head.protocol || 0 == block_head.original_count || block_head.block_id >= block_head.original_count + block_head.recovery_count)
+    else
     {
-        return false;
+        block_head_t head = block_head;
+        head.protocol = s_protocol;
+        head.encode();
+        memcpy(data, &head, sizeof(head));
     }
-
-    return true;
 }
 
-static bool cm256_decode(const void * data, uint32_t size, groups_t & groups, std::list<std::vector<uint8_t>> & dst_list, uint32_t max_delay_microseconds, decode_callback_t decode_callback, void * user_data)
+static bool read_block_head(const uint8_t * data, uint32_t size, block_head_t & block_head, block_format_t & block_format)
 {
-    if (nullptr != data && 0 != size)
+    if (nullptr == data || 0 == size)
+    {
+        return false;
+    }
+
+    if (s_compact_protocol == data[0])
     {
-        if (!insert_group_block(data, size, groups, max_delay_microseconds))
+        if (size < 2 || 0 != (data[1] & ~s_compact_flags))
         {
             return false;
         }
 
-        const group_src_t & group_src = groups.src_item[groups.new_group_id];
-        if (group_src.head.block_count != group_src.head.original_count && groups.new_group_id == groups.min_group_id)
+        make_block_format(s_compact_protocol, data[1], block_format);
+        if (size <= block_format.head_size)
         {
             return false;
         }
-    }
-
-    std::size_t old_dst_list_size = dst_list.size();
-    std::size_t new_dst_list_size = old_dst_list_size;
 
-    uint32_t current_seconds = 0;
-    uint32_t current_microseconds = 0;
-    get_current_time(current_seconds, current_microseconds);
-    std::list<decode_timer_t>::iterator iter = groups.decode_timer_list.begin();
-    while (groups.decode_timer_list.end() != iter)
-    {
-        const decode_timer_t & decode_timer = *iter;
-        group_src_t & group_src = groups.src_item[decode_timer.group_id];
-        if (group_src.head.block_count == group_src.head.original_count)
+        const uint8_t * head = data + 2;
+        block_head.group_id = 0;
+        for (uint32_t bits = 0; bits < block_format.group_id_bits; bits += 8)
         {
-            uint64_t min_group_id = 0;
-            uint64_t max_group_id = 0;
-            if (cm256_decode_group(group_src.head, group_src.body, groups, min_group_id, max_group_id))
-            {
-                if (decode_timer.group_id + 1 == max_group_id)
-                {
-                    group_dst_t & group_dst = groups.dst_item[max_group_id - 1];
-                    if (group_dst.complete())
-                    {
-                        if (nullptr != decode_callback)
-                        {
-                            (*decode_callback)(user_data, &group_dst.data[0], static_cast<uint32_t>(group_dst.data.size()));
-                        }
-                        else
-                        {
-                            dst_list.emplace_back(std::move(group_dst.data));
-                        }
-                        ++new_dst_list_size;
-                    }
-                    groups.dst_item.erase(max_group_id - 1);
-                }
-            }
-            else
+            block_head.group_id = (block_head.group_id << 8) | *head++;
+        }
+        block_head.protocol = s_compact_protocol;
+        block_head.block_id = *head++;
+        block_head.original_count = *head++;
+        block_head.recovery_count = *head++;
+        if (0 != (block_format.flags & s_compact_flag_timestamp))
+        {
+            for (uint32_t bits = 0; bits < 32; bits += 8)
             {
-                if (decode_timer.group_id + 1 == max_group_id)
-                {
-                    groups.dst_item.erase(max_group_id - 1);
-                }
+                block_format.timestamp = (block_format.timestamp << 8) | *head++;
             }
-            groups.src_item.erase(decode_timer.group_id);
-            groups.min_group_id = decode_timer.group_id + 1;
-            iter = groups.decode_timer_list.erase(iter);
+            block_format.duration = static_cast<uint16_t>((head[0] << 8) | head[1]);
         }
-        else if ((decode_timer.decode_seconds < current_seconds) || (decode_timer.decode_seconds == current_seconds && decode_timer.decode_microseconds < current_microseconds))
+    }
+    else
+    {
+        if (size < sizeof(block_t))
         {
-            groups.src_item.erase(decode_timer.group_id);
-            groups.min_group_id = decode_timer.group_id + 1;
-            iter = groups.decode_timer_list.erase(iter);
+            return false;
         }
-        else
+
+        memcpy(&block_head, data, sizeof(block_head));
+        block_head.decode();
+
+        if (s_protocol != block_head.protocol || block_head.group_id >= s_group_id_limit)
         {
-            break;
+            return false;
         }
+
+        make_block_format(s_protocol, 0, block_format);
+    }
+
+    /* block ids behind the recovery blocks of the group are repair blocks made on request */
+    if (0 == block_head.original_count || block_head.original_count + block_head.recovery_count > 256)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static void output_block(block_buffer_t & buffer, std::list<std::vector<uint8_t>> & dst_blocks, encode_callback_t encode_callback, void * user_data)
+{
+    if (nullptr != encode_callback)
+    {
+        (*encode_callback)(user_data, buffer.data(), buffer.size);
+    }
+    else
+    {
+        dst_blocks.emplace_back(std::vector<uint8_t>(buffer.data(), buffer.data() + buffer.size));
+    }
+}
+
+static bool create_original_blocks(CM256::cm256_block * blocks, block_buffer_t * buffers, std::list<std::vector<uint8_t>> & original_blocks, const block_format_t & block_format, const block_head_t & block_head, block_body_t & block_body, const uint8_t *& data, uint32_t & size, bool shorten_last_block, encode_callback_t encode_callback, void * user_data)
+{
+    const uint32_t block_size = static_cast<uint32_t>(sizeof(block_t) + block_body.block_bytes);
+
+    block_head_t original_head = block_head;
+
+    for (uint8_t block_id = 0; block_id < block_head.original_count; ++block_id)
+    {
+        block_buffer_t & original_buffer = buffers[block_id];
+        original_buffer.assign(block_size, block_format.head_size);
+
+        original_head.block_id = block_id;
+        write_block_head(original_buffer.data(), block_format, original_head);
+
+        block_t * block = original_buffer.block();
+
+        block->body.block_index = block_body.block_index++;
+        block->body.block_bytes = std::min<uint32_t>(size, block_body.block_bytes);
+        block->body.frame_size = block_body.frame_size;
+        block->body.frame_index = block_body.frame_index;
+        block->body.frame_count = block_body.frame_count;
+
+        if (0 != block->body.block_bytes)
+        {
+            memcpy(original_buffer.data() + sizeof(block_t), data, block->body.block_bytes);
+            data += block->body.block_bytes;
+            size -= block->body.block_bytes;
+        }
+
+        if (shorten_last_block && block_id + 1 == block_head.original_count)
+        {
+            original_buffer.size = static_cast<uint32_t>(sizeof(block_t) + block->body.block_bytes);
+        }
+
+        block->body.encode();
+
+        blocks[block_id].Block = original_buffer.coded();
+        blocks[block_id].Index = block_id;
+
+        output_block(original_buffer, original_blocks, encode_callback, user_data);
+    }
+
+    return true;
+}
+
+static bool create_compact_original_blocks(CM256::cm256_block * blocks, block_buffer_t * buffers, std::list<std::vector<uint8_t>> & original_blocks, const block_format_t & block_format, const block_head_t & block_head, uint32_t block_bytes, const record_t * records, uint32_t record_count, bool shorten_last_block, encode_callback_t encode_callback, void * user_data)
+{
+    uint8_t * coded_blocks[256] = { 0x0 };
+
+    block_head_t original_head = block_head;
+
+    for (uint8_t block_id = 0; block_id < block_head.original_count; ++block_id)
+    {
+        block_buffer_t & original_buffer = buffers[block_id];
+        original_buffer.assign(block_format.head_size + block_bytes, block_format.head_size);
+
+        original_head.block_id = block_id;
+        write_block_head(original_buffer.data(), block_format, original_head);
+
+        blocks[block_id].Block = original_buffer.coded();
+        blocks[block_id].Index = block_id;
+
+        coded_blocks[block_id] = original_buffer.coded();
+    }
+
+    group_stream_t group_stream(coded_blocks, block_head.original_count, block_bytes);
+    for (uint32_t record_index = 0; record_index < record_count; ++record_index)
+    {
+        if (!group_stream.write_record(records[record_index].head) || !group_stream.write(records[record_index].data, records[record_index].head.bytes))
+        {
+            return false;
+        }
+    }
+
+    if (shorten_last_block)
+    {
+        buffers[block_head.original_count - 1].size = block_format.head_size + static_cast<uint32_t>(group_stream.position - static_cast<uint64_t>(block_head.original_count - 1) * block_bytes);
+    }
+
+    for (uint8_t block_id = 0; block_id < block_head.original_count; ++block_id)
+    {
+        output_block(buffers[block_id], original_blocks, encode_callback, user_data);
+    }
+
+    return true;
+}
+
+static bool create_recovery_blocks(CM256 & cm256, CM256::cm256_block * blocks, block_buffer_t * buffers, std::list<std::vector<uint8_t>> & recovery_blocks, const block_format_t & block_format, const block_head_t & block_head, uint32_t block_bytes, encode_callback_t encode_callback, void * user_data)
+{
+    if (0 == block_head.recovery_count)
+    {
+        return true;
+    }
+
+    uint8_t * recovery_data[256] = { 0x0 };
+
+    block_head_t recovery_head = block_head;
+
+    for (uint8_t block_id = 0; block_id < block_head.recovery_count; ++block_id)
+    {
+        block_buffer_t & recovery_buffer = buffers[block_head.original_count + block_id];
+        recovery_buffer.assign(block_format.head_size + block_bytes, block_format.head_size);
+
+        recovery_head.block_id = block_head.original_count + block_id;
+        write_block_head(recovery_buffer.data(), block_format, recovery_head);
+
+        blocks[block_head.original_count + block_id].Block = recovery_buffer.coded();
+        blocks[block_head.original_count + block_id].Index = block_head.original_count + block_id;
+
+        recovery_data[block_id] = recovery_buffer.coded();
+    }
+
+    if (!cm256.isInitialized())
+    {
+        return false;
+    }
+
+    CM256::cm256_encoder_params params = { block_head.original_count, block_head.recovery_count, static_cast<int>(cache_line_align(block_bytes)) };
+    if (0 != cm256.cm256_encode(params, blocks, recovery_data))
+    {
+        return false;
+    }
+
+    for (uint8_t block_id = 0; block_id < block_head.recovery_count; ++block_id)
+    {
+        output_block(buffers[block_head.original_count + block_id], recovery_blocks, encode_callback, user_data);
+    }
+
+    return true;
+}
+
+/*
+ * originals of a sent group, kept to make recovery blocks with block ids that were never sent
+ */
+struct repair_group_t
+{
+    block_format_t                      block_format;
+    block_head_t                        block_head;
+    uint32_t                            block_bytes;
+    uint32_t                            next_block_id;
+    std::vector<block_buffer_t>         original_buffers;
+
+    repair_group_t()
+        : block_format()
+        , block_head()
+        , block_bytes(0)
+        , next_block_id(0)
+        , original_buffers()
+    {
+
+    }
+};
+
+struct repair_cache_t
+{
+    std::list<repair_group_t>           group_list;
+
+    repair_cache_t()
+        : group_list()
+    {
+
+    }
+
+    void reset()
+    {
+        group_list.clear();
+    }
+};
+
+static void cache_repair_group(const encode_option_t & option, repair_cache_t & repair_cache, const block_format_t & block_format, const block_head_t & block_head, uint32_t block_bytes, const CM256::cm256_block * blocks)
+{
+    if (0 == option.repair_cache_groups)
+    {
+        return;
+    }
+
+    while (repair_cache.group_list.size() >= option.repair_cache_groups)
+    {
+        repair_cache.group_list.pop_front();
+    }
+
+    /* the buffers are filled in place, a copy of them would lose the alignment of their coded regions */
+    repair_cache.group_list.push_back(repair_group_t());
+    repair_group_t & repair_group = repair_cache.group_list.back();
+    repair_group.block_format = block_format;
+    repair_group.block_head = block_head;
+    repair_group.block_bytes = block_bytes;
+    repair_group.next_block_id = block_head.original_count + block_head.recovery_count;
+    repair_group.original_buffers.resize(block_head.original_count);
+    for (uint32_t block_id = 0; block_id < block_head.original_count; ++block_id)
+    {
+        block_buffer_t & original_buffer = repair_group.original_buffers[block_id];
+        original_buffer.assign(block_format.head_size + block_bytes, block_format.head_size);
+        memcpy(original_buffer.coded(), blocks[block_id].Block, block_bytes);
+    }
+}
+
+/*
+ * answer a repair request of a receiver with block_count recovery blocks of block ids not sent before,
+ * group_id is the one on the wire, so only its low group_id_bits are compared
+ */
+static bool cm256_repair(CM256 & cm256, uint64_t group_id, uint32_t block_count, repair_cache_t & repair_cache, std::vector<block_buffer_t> & buffers, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    if (!cm256.isInitialized())
+    {
+        return false;
+    }
+
+    for (std::list<repair_group_t>::reverse_iterator iter = repair_cache.group_list.rbegin(); repair_cache.group_list.rend() != iter; ++iter)
+    {
+        repair_group_t & repair_group = *iter;
+
+        const uint64_t group_id_mask = (repair_group.block_format.group_id_bits >= 64 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << repair_group.block_format.group_id_bits) - 1);
+        if ((repair_group.block_head.group_id & group_id_mask) != (group_id & group_id_mask))
+        {
+            continue;
+        }
+
+        if (repair_group.next_block_id > 255)
+        {
+            return false;
+        }
+
+        CM256::cm256_block blocks[256];
+        for (uint32_t block_id = 0; block_id < repair_group.block_head.original_count; ++block_id)
+        {
+            blocks[block_id].Block = repair_group.original_buffers[block_id].coded();
+            blocks[block_id].Index = static_cast<uint8_t>(block_id);
+        }
+
+        CM256::cm256_encoder_params params = { repair_group.block_head.original_count, 256 - repair_group.block_head.original_count, static_cast<int>(cache_line_align(repair_group.block_bytes)) };
+
+        buffers.resize(256);
+
+        block_buffer_t & repair_buffer = buffers[0];
+        block_head_t repair_head = repair_group.block_head;
+
+        for (uint32_t block_index = 0; block_index < block_count && repair_group.next_block_id <= 255; ++block_index)
+        {
+            repair_buffer.assign(repair_group.block_format.head_size + repair_group.block_bytes, repair_group.block_format.head_size);
+
+            repair_head.block_id = static_cast<uint8_t>(repair_group.next_block_id);
+            write_block_head(repair_buffer.data(), repair_group.block_format, repair_head);
+
+            cm256.cm256_encode_block(params, blocks, repair_group.next_block_id, repair_buffer.coded());
+
+            output_block(repair_buffer, dst_list, encode_callback, user_data);
+
+            ++repair_group.next_block_id;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * emit the groups of a frame plan, they are the groups frame_index_base... of a frame of frame_count groups
+ */
+static bool cm256_encode_plan(CM256 & cm256, const uint8_t * src_data, uint32_t src_size, const encode_option_t & option, const block_format_t & block_format, const frame_plan_t & frame_plan, uint32_t frame_index_base, uint32_t frame_count, uint64_t & group_id, std::vector<block_buffer_t> & buffers, repair_cache_t & repair_cache, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    buffers.resize(256);
+
+    const uint32_t group_count = static_cast<uint32_t>(frame_plan.group_plans.size());
+
+    for (uint32_t group_index = 0; group_index < group_count; ++group_index)
+    {
+        const group_plan_t & group_plan = frame_plan.group_plans[group_index];
+        const uint32_t frame_index = frame_index_base + group_index;
+
+        block_head_t block_head = { 0x0 };
+        block_head.group_id = group_id;
+        block_head.original_count = group_plan.original_count;
+        block_head.recovery_count = group_plan.recovery_count;
+
+        CM256::cm256_block blocks[256];
+
+        std::list<std::vector<uint8_t>> original_blocks;
+        if (s_compact_protocol == block_format.protocol)
+        {
+            const record_t record = { { src_size, group_plan.frame_offset, frame_index, frame_count, group_plan.frame_bytes }, src_data + group_plan.frame_offset };
+            if (!create_compact_original_blocks(blocks, &buffers[0], original_blocks, block_format, block_head, frame_plan.block_bytes, &record, 1, option.shorten_last_block, encode_callback, user_data))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            block_body_t block_body = { 0x0 };
+            block_body.block_bytes = static_cast<uint32_t>(frame_plan.block_bytes - sizeof(block_body_t));
+            block_body.block_index = group_plan.frame_offset / block_body.block_bytes;
+            block_body.frame_size = src_size;
+            block_body.frame_index = static_cast<uint16_t>(frame_index);
+            block_body.frame_count = static_cast<uint16_t>(frame_count);
+
+            const uint8_t * data = src_data + group_plan.frame_offset;
+            uint32_t size = group_plan.frame_bytes;
+            if (!create_original_blocks(blocks, &buffers[0], original_blocks, block_format, block_head, block_body, data, size, option.shorten_last_block, encode_callback, user_data))
+            {
+                return false;
+            }
+        }
+
+        std::list<std::vector<uint8_t>> recovery_blocks;
+        if (!create_recovery_blocks(cm256, blocks, &buffers[0], recovery_blocks, block_format, block_head, frame_plan.block_bytes, encode_callback, user_data))
+        {
+            return false;
+        }
+
+        cache_repair_group(option, repair_cache, block_format, block_head, frame_plan.block_bytes, blocks);
+
+        dst_list.splice(dst_list.end(), original_blocks);
+        dst_list.splice(dst_list.end(), recovery_blocks);
+
+        next_group_id(group_id);
+    }
+
+    return true;
+}
+
+static bool cm256_encode_frame(CM256 & cm256, const uint8_t * src_data, uint32_t src_size, const encode_option_t & option, const block_format_t & block_format, uint64_t & group_id, std::vector<block_buffer_t> & buffers, repair_cache_t & repair_cache, encode_stats_t & encode_stats, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    frame_plan_t frame_plan;
+    if (!(option.adaptive_block_size ? plan_adaptive_frame(src_size, option, block_format, frame_plan) : plan_frame(src_size, option, block_format, frame_plan)))
+    {
+        return false;
+    }
+
+    encode_stats.frame_size = src_size;
+    encode_stats.block_size = block_format.head_size + frame_plan.block_bytes;
+    encode_stats.group_count = static_cast<uint32_t>(frame_plan.group_plans.size());
+    count_frame_plan(frame_plan, encode_stats.original_count, encode_stats.recovery_count);
+    encode_stats.transmit_bytes = frame_plan_bytes(src_size, frame_plan, option, block_format);
+
+    return cm256_encode_plan(cm256, src_data, src_size, option, block_format, frame_plan, 0, encode_stats.group_count, group_id, buffers, repair_cache, dst_list, encode_callback, user_data);
+}
+
+static bool cm256_encode_protected_frame(CM256 & cm256, const uint8_t * src_data, uint32_t src_size, const encode_option_t & option, const std::vector<protect_range_t> & protect_ranges, const block_format_t & block_format, uint64_t & group_id, std::vector<block_buffer_t> & buffers, repair_cache_t & repair_cache, encode_stats_t & encode_stats, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    if (s_compact_protocol != block_format.protocol)
+    {
+        return false;
+    }
+
+    std::vector<protect_segment_t> protect_segments;
+    uint32_t frame_count = 0;
+    if (!make_protect_segments(src_size, option.recovery_rate, protect_ranges, protect_segments) || !plan_protected_frame(src_size, option, block_format, protect_segments, frame_count))
+    {
+        return false;
+    }
+
+    encode_stats = encode_stats_t();
+    encode_stats.frame_size = src_size;
+    encode_stats.group_count = frame_count;
+
+    for (std::vector<protect_segment_t>::const_iterator iter = protect_segments.begin(); protect_segments.end() != iter; ++iter)
+    {
+        uint32_t original_count = 0;
+        uint32_t recovery_count = 0;
+        count_frame_plan(iter->frame_plan, original_count, recovery_count);
+        encode_stats.block_size = std::max<uint32_t>(encode_stats.block_size, block_format.head_size + iter->frame_plan.block_bytes);
+        encode_stats.original_count += original_count;
+        encode_stats.recovery_count += recovery_count;
+        encode_stats.transmit_bytes += frame_plan_bytes(src_size, iter->frame_plan, iter->frame_index, frame_count, option, block_format);
+
+        if (!cm256_encode_plan(cm256, src_data, src_size, option, block_format, iter->frame_plan, iter->frame_index, frame_count, group_id, buffers, repair_cache, dst_list, encode_callback, user_data))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * small frames held back to share one compact group, each one is a whole record (frame_count 1) of the group stream
+ */
+struct aggregate_t
+{
+    std::list<std::vector<uint8_t>>     frame_list;
+    uint32_t                            frame_bytes;
+    uint32_t                            stream_bytes;
+    double                              recovery_rate;
+    uint64_t                            first_time;
+
+    aggregate_t()
+        : frame_list()
+        , frame_bytes(0)
+        , stream_bytes(0)
+        , recovery_rate(0.0)
+        , first_time(0)
+    {
+
+    }
+
+    void reset()
+    {
+        frame_list.clear();
+        frame_bytes = 0;
+        stream_bytes = 0;
+        recovery_rate = 0.0;
+        first_time = 0;
+    }
+};
+
+static uint32_t aggregate_capacity(const encode_option_t & option, const block_format_t & block_format)
+{
+    return static_cast<uint32_t>(std::min<uint64_t>(option.aggregate_bytes, static_cast<uint64_t>(group_original_count(option)) * (option.max_block_size - block_format.head_size)));
+}
+
+static bool cm256_encode_aggregate(CM256 & cm256, const encode_option_t & option, const block_format_t & block_format, aggregate_t & aggregate, uint64_t & group_id, std::vector<block_buffer_t> & buffers, repair_cache_t & repair_cache, encode_stats_t & encode_stats, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    if (aggregate.frame_list.empty())
+    {
+        return true;
+    }
+
+    std::vector<record_t> records;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = aggregate.frame_list.begin(); aggregate.frame_list.end() != iter; ++iter)
+    {
+        const uint32_t frame_size = static_cast<uint32_t>(iter->size());
+        const record_t record = { { frame_size, 0, 0, 1, frame_size }, &(*iter)[0] };
+        records.push_back(record);
+    }
+
+    const uint32_t max_block_bytes = option.max_block_size - block_format.head_size;
+    const uint32_t block_count = (aggregate.stream_bytes + max_block_bytes - 1) / max_block_bytes;
+    const uint32_t block_bytes = (option.adaptive_block_size ? (aggregate.stream_bytes + block_count - 1) / block_count : std::min<uint32_t>(max_block_bytes, aggregate.stream_bytes));
+
+    /* the shared group is protected as well as the most demanding frame in it asks for */
+    encode_option_t aggregate_option = option;
+    aggregate_option.recovery_rate = aggregate.recovery_rate;
+
+    block_head_t block_head = { 0x0 };
+    block_head.group_id = group_id;
+    block_head.original_count = static_cast<uint8_t>(block_count);
+    block_head.recovery_count = plan_recovery_count(block_count, aggregate_option);
+
+    buffers.resize(256);
+
+    CM256::cm256_block blocks[256];
+
+    std::list<std::vector<uint8_t>> original_blocks;
+    if (!create_compact_original_blocks(blocks, &buffers[0], original_blocks, block_format, block_head, block_bytes, &records[0], static_cast<uint32_t>(records.size()), option.shorten_last_block, encode_callback, user_data))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> recovery_blocks;
+    if (!create_recovery_blocks(cm256, blocks, &buffers[0], recovery_blocks, block_format, block_head, block_bytes, encode_callback, user_data))
+    {
+        return false;
+    }
+
+    cache_repair_group(option, repair_cache, block_format, block_head, block_bytes, blocks);
+
+    dst_list.splice(dst_list.end(), original_blocks);
+    dst_list.splice(dst_list.end(), recovery_blocks);
+
+    next_group_id(group_id);
+
+    encode_stats.frame_size = aggregate.frame_bytes;
+    encode_stats.block_size = block_format.head_size + block_bytes;
+    encode_stats.group_count = 1;
+    encode_stats.original_count = block_head.original_count;
+    encode_stats.recovery_count = block_head.recovery_count;
+    encode_stats.transmit_bytes = static_cast<uint64_t>(block_head.original_count + block_head.recovery_count) * encode_stats.block_size;
+    if (option.shorten_last_block)
+    {
+        encode_stats.transmit_bytes -= static_cast<uint64_t>(block_count) * block_bytes - aggregate.stream_bytes;
+    }
+
+    aggregate.reset();
+
+    return true;
+}
+
+static bool check_encode_option(const encode_option_t & option, block_format_t & block_format)
+{
+    if (option.recovery_rate < 0.0 || option.recovery_rate >= 1.0)
+    {
+        return false;
+    }
+
+    make_encode_format(option, block_format);
+
+    if (option.max_block_size <= (s_compact_protocol == block_format.protocol ? block_format.head_size : sizeof(block_t)))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static bool cm256_encode_groups(CM256 & cm256, const uint8_t * src_data, uint32_t src_size, const encode_option_t & option, const std::vector<protect_range_t> & protect_ranges, const block_format_t & block_format, uint64_t & group_id, std::vector<block_buffer_t> & buffers, repair_cache_t & repair_cache, aggregate_t & aggregate, encode_stats_t & encode_stats, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    if (!protect_ranges.empty())
+    {
+        if (!cm256_encode_aggregate(cm256, option, block_format, aggregate, group_id, buffers, repair_cache, encode_stats, dst_list, encode_callback, user_data))
+        {
+            return false;
+        }
+        return cm256_encode_protected_frame(cm256, src_data, src_size, option, protect_ranges, block_format, group_id, buffers, repair_cache, encode_stats, dst_list, encode_callback, user_data);
+    }
+
+    if (0 == option.aggregate_bytes || s_compact_protocol != block_format.protocol)
+    {
+        return cm256_encode_frame(cm256, src_data, src_size, option, block_format, group_id, buffers, repair_cache, encode_stats, dst_list, encode_callback, user_data);
+    }
+
+    const record_head_t record_head = { src_size, 0, 0, 1, src_size };
+    const uint64_t stream_bytes = static_cast<uint64_t>(record_head.size()) + src_size;
+    const uint32_t capacity = aggregate_capacity(option, block_format);
+
+    if (aggregate.stream_bytes + stream_bytes > capacity)
+    {
+        if (!cm256_encode_aggregate(cm256, option, block_format, aggregate, group_id, buffers, repair_cache, encode_stats, dst_list, encode_callback, user_data))
+        {
+            return false;
+        }
+        if (stream_bytes > capacity)
+        {
+            return cm256_encode_frame(cm256, src_data, src_size, option, block_format, group_id, buffers, repair_cache, encode_stats, dst_list, encode_callback, user_data);
+        }
+    }
+
+    /* the hold is timed on the steady clock, a wall clock step would flush too early or hold too long */
+    const uint64_t current_time = get_steady_nanoseconds() / 1000;
+
+    if (aggregate.frame_list.empty())
+    {
+        aggregate.first_time = current_time;
+    }
+    aggregate.frame_list.emplace_back(std::vector<uint8_t>(src_data, src_data + src_size));
+    aggregate.frame_bytes += src_size;
+    aggregate.stream_bytes += static_cast<uint32_t>(stream_bytes);
+    aggregate.recovery_rate = std::max<double>(aggregate.recovery_rate, option.recovery_rate);
+
+    if (aggregate.stream_bytes == capacity || current_time - aggregate.first_time >= static_cast<uint64_t>(option.aggregate_millisecond) * 1000)
+    {
+        return cm256_encode_aggregate(cm256, option, block_format, aggregate, group_id, buffers, repair_cache, encode_stats, dst_list, encode_callback, user_data);
+    }
+
+    return true;
+}
+
+/*
+ * groups waiting to be sent interleaved, each one holds its packets in sending order
+ */
+struct interleave_t
+{
+    std::list<std::list<std::vector<uint8_t>>>  group_list;
+    uint64_t                                    first_time;
+
+    interleave_t()
+        : group_list()
+        , first_time(0)
+    {
+
+    }
+
+    void reset()
+    {
+        group_list.clear();
+        first_time = 0;
+    }
+};
+
+static void queue_interleave_groups(std::list<std::vector<uint8_t>> & block_list, interleave_t & interleave)
+{
+    if (!block_list.empty() && interleave.group_list.empty())
+    {
+        interleave.first_time = get_steady_nanoseconds() / 1000;
+    }
+
+    /* the packets of a group are contiguous, its first head tells how many there are */
+    while (!block_list.empty())
+    {
+        block_head_t block_head = { 0x0 };
+        block_format_t block_format = { 0x0 };
+        if (!read_block_head(&block_list.front()[0], static_cast<uint32_t>(block_list.front().size()), block_head, block_format))
+        {
+            block_list.clear();
+            break;
+        }
+
+        std::list<std::vector<uint8_t>>::iterator group_end = block_list.begin();
+        std::advance(group_end, std::min<std::size_t>(block_head.original_count + block_head.recovery_count, block_list.size()));
+
+        interleave.group_list.emplace_back();
+        interleave.group_list.back().splice(interleave.group_list.back().end(), block_list, block_list.begin(), group_end);
+    }
+}
+
+/*
+ * send the queued groups in windows of interleave_depth consecutive groups, inside a window
+ * the next packet always comes from the group that is least far through its own packets,
+ * so that groups of equal size go round robin and a long group is spread over the whole window
+ */
+static void output_interleave_groups(interleave_t & interleave, uint32_t interleave_depth, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    while (!interleave.group_list.empty())
+    {
+        std::vector<std::list<std::list<std::vector<uint8_t>>>::iterator> window;
+        std::vector<std::pair<uint32_t, uint32_t>> progress;
+        for (std::list<std::list<std::vector<uint8_t>>>::iterator iter = interleave.group_list.begin(); interleave.group_list.end() != iter && window.size() < interleave_depth; ++iter)
+        {
+            window.push_back(iter);
+            progress.push_back(std::make_pair(0, static_cast<uint32_t>(iter->size())));
+        }
+
+        while (true)
+        {
+            uint32_t next = static_cast<uint32_t>(window.size());
+            for (uint32_t index = 0; index < window.size(); ++index)
+            {
+                if (progress[index].first == progress[index].second)
+                {
+                    continue;
+                }
+                /* (sent + 0.5) / count, compared without division */
+                if (next == window.size() || static_cast<uint64_t>(2 * progress[index].first + 1) * progress[next].second < static_cast<uint64_t>(2 * progress[next].first + 1) * progress[index].second)
+                {
+                    next = index;
+                }
+            }
+            if (next == window.size())
+            {
+                break;
+            }
+
+            std::list<std::vector<uint8_t>> & group = *window[next];
+            if (nullptr != encode_callback)
+            {
+                (*encode_callback)(user_data, &group.front()[0], static_cast<uint32_t>(group.front().size()));
+                group.pop_front();
+            }
+            else
+            {
+                dst_list.splice(dst_list.end(), group, group.begin());
+            }
+            progress[next].first += 1;
+        }
+
+        interleave.group_list.erase(interleave.group_list.begin(), ++window.back());
+    }
+
+    interleave.reset();
+}
+
+static bool cm256_encode(CM256 & cm256, const uint8_t * src_data, uint32_t src_size, const encode_option_t & option, const frame_option_t & frame_option, uint64_t & group_id, std::vector<block_buffer_t> & buffers, repair_cache_t & repair_cache, aggregate_t & aggregate, interleave_t & interleave, encode_stats_t & encode_stats, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    if (nullptr == src_data || 0 == src_size)
+    {
+        return false;
+    }
+
+    block_format_t block_format = { 0x0 };
+    if (!check_encode_option(option, block_format))
+    {
+        return false;
+    }
+
+    block_format.timestamp = (0 != frame_option.timestamp ? frame_option.timestamp : get_current_timestamp());
+    block_format.duration = frame_option.duration;
+
+    if (option.interleave_depth < 2)
+    {
+        return cm256_encode_groups(cm256, src_data, src_size, option, frame_option.protect_ranges, block_format, group_id, buffers, repair_cache, aggregate, encode_stats, dst_list, encode_callback, user_data);
+    }
+
+    std::list<std::vector<uint8_t>> block_list;
+    if (!cm256_encode_groups(cm256, src_data, src_size, option, frame_option.protect_ranges, block_format, group_id, buffers, repair_cache, aggregate, encode_stats, block_list, nullptr, nullptr))
+    {
+        return false;
+    }
+
+    queue_interleave_groups(block_list, interleave);
+
+    if (interleave.group_list.empty())
+    {
+        return true;
+    }
+
+    /* steady clock, as the aggregate hold */
+    const uint64_t waited_microseconds = get_steady_nanoseconds() / 1000 - interleave.first_time;
+    if (interleave.group_list.size() >= option.interleave_depth || waited_microseconds >= static_cast<uint64_t>(option.interleave_millisecond) * 1000)
+    {
+        output_interleave_groups(interleave, option.interleave_depth, dst_list, encode_callback, user_data);
+    }
+
+    return true;
+}
+
+static bool cm256_flush(CM256 & cm256, const encode_option_t & option, uint64_t & group_id, std::vector<block_buffer_t> & buffers, repair_cache_t & repair_cache, aggregate_t & aggregate, interleave_t & interleave, encode_stats_t & encode_stats, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    block_format_t block_format = { 0x0 };
+    if (!check_encode_option(option, block_format))
+    {
+        return false;
+    }
+
+    block_format.timestamp = get_current_timestamp();
+
+    if (option.interleave_depth < 2)
+    {
+        return cm256_encode_aggregate(cm256, option, block_format, aggregate, group_id, buffers, repair_cache, encode_stats, dst_list, encode_callback, user_data);
+    }
+
+    std::list<std::vector<uint8_t>> block_list;
+    if (!cm256_encode_aggregate(cm256, option, block_format, aggregate, group_id, buffers, repair_cache, encode_stats, block_list, nullptr, nullptr))
+    {
+        return false;
+    }
+
+    queue_interleave_groups(block_list, interleave);
+    output_interleave_groups(interleave, option.interleave_depth, dst_list, encode_callback, user_data);
+
+    return true;
+}
+
+/*
+ * loss of the receiver, smoothed over its reports
+ */
+struct loss_model_t
+{
+    double                              loss_rate;
+    double                              burst_length;
+    uint32_t                            report_count;
+
+    loss_model_t()
+        : loss_rate(0.0)
+        , burst_length(1.0)
+        , report_count(0)
+    {
+
+    }
+
+    void reset()
+    {
+        loss_rate = 0.0;
+        burst_length = 1.0;
+        report_count = 0;
+    }
+};
+
+static void update_loss_model(loss_model_t & loss_model, const receive_report_t & receive_report)
+{
+    if (0 == receive_report.expected_blocks)
+    {
+        return;
+    }
+
+    const double loss_rate = (receive_report.received_blocks >= receive_report.expected_blocks ? 0.0 : static_cast<double>(receive_report.expected_blocks - receive_report.received_blocks) / receive_report.expected_blocks);
+
+    const double burst_lengths[] = { 1.0, 2.0, 3.5, 6.5, 12.5, 24.0 };
+    double burst_count = 0.0;
+    double burst_blocks = 0.0;
+    for (uint32_t index = 0; index < sizeof(burst_lengths) / sizeof(burst_lengths[0]); ++index)
+    {
+        burst_count += receive_report.burst_histogram[index];
+        burst_blocks += receive_report.burst_histogram[index] * burst_lengths[index];
+    }
+    const double burst_length = (burst_count > 0.0 ? burst_blocks / burst_count : 1.0);
+
+    const double weight = (0 == loss_model.report_count ? 1.0 : 0.25);
+    loss_model.loss_rate += (loss_rate - loss_model.loss_rate) * weight;
+    loss_model.burst_length += (burst_length - loss_model.burst_length) * weight;
+    loss_model.report_count += 1;
+}
+
+/*
+ * fewest recovery blocks for a group of original_count blocks so that it is lost with target_loss_rate at most,
+ * losses come as independent bursts of burst_length blocks and the group survives as many bursts as its recovery blocks cover
+ */
+static bool model_recovery_count(const loss_model_t & loss_model, uint32_t original_count, double target_loss_rate, uint32_t & recovery_count)
+{
+    const double burst_rate = std::min<double>(loss_model.loss_rate / loss_model.burst_length, 0.5);
+
+    for (recovery_count = 0; original_count + recovery_count < 256; ++recovery_count)
+    {
+        const uint32_t block_count = original_count + recovery_count;
+        const uint32_t max_burst_count = static_cast<uint32_t>(recovery_count / loss_model.burst_length);
+
+        /* binomial probability of max_burst_count bursts at most */
+        double probability = pow(1.0 - burst_rate, static_cast<double>(block_count));
+        double survive_rate = probability;
+        for (uint32_t burst_count = 0; burst_count < max_burst_count && burst_count < block_count; ++burst_count)
+        {
+            probability *= static_cast<double>(block_count - burst_count) / (burst_count + 1) * burst_rate / (1.0 - burst_rate);
+            survive_rate += probability;
+        }
+
+        if (1.0 - survive_rate <= target_loss_rate)
+        {
+            return true;
+        }
+    }
+
+    recovery_count = 255 - original_count;
+
+    return false;
+}
+
+/*
+ * recovery rate of a frame from the loss model, for the size of the groups the frame will be split into
+ */
+static double model_recovery_rate(const loss_model_t & loss_model, uint32_t frame_size, const encode_option_t & option)
+{
+    block_format_t block_format = { 0x0 };
+    make_encode_format(option, block_format);
+
+    const uint32_t block_head = (s_compact_protocol == block_format.protocol ? block_format.head_size : static_cast<uint32_t>(sizeof(block_t)));
+    if (option.max_block_size <= block_head)
+    {
+        return option.recovery_rate;
+    }
+
+    const uint32_t block_bytes = option.max_block_size - block_head;
+    const uint32_t plan_size = std::max<uint32_t>(frame_size, option.aggregate_bytes);
+    uint32_t original_count = std::max<uint32_t>(std::min<uint32_t>((plan_size + block_bytes - 1) / block_bytes, option.max_original_count), 1);
+
+    /* a group with no room left for the recovery blocks it needs is made smaller, the largest one that fits is searched */
+    uint32_t recovery_count = 0;
+    if (!model_recovery_count(loss_model, original_count, option.target_loss_rate, recovery_count))
+    {
+        uint32_t min_original_count = 1;
+        uint32_t max_original_count = original_count;
+        while (min_original_count + 1 < max_original_count)
+        {
+            const uint32_t mid_original_count = (min_original_count + max_original_count) / 2;
+            if (model_recovery_count(loss_model, mid_original_count, option.target_loss_rate, recovery_count))
+            {
+                min_original_count = mid_original_count;
+            }
+            else
+            {
+                max_original_count = mid_original_count;
+            }
+        }
+        original_count = min_original_count;
+        model_recovery_count(loss_model, original_count, option.target_loss_rate, recovery_count);
+    }
+
+    if (0 == recovery_count && option.force_recovery)
+    {
+        recovery_count = 1;
+    }
+
+    return std::min<double>(static_cast<double>(recovery_count) / (original_count + recovery_count), option.max_recovery_rate);
+}
+
+static uint64_t expand_group_id(groups_t & groups, uint64_t group_id, uint32_t group_id_bits)
+{
+    if (group_id_bits >= 64)
+    {
+        return group_id;
+    }
+
+    /* serial number arithmetic against the newest group seen, the first one is lifted away from zero so that reordered older groups stay representable */
+    const uint64_t group_id_range = static_cast<uint64_t>(1) << group_id_bits;
+    if (!groups.serial_valid)
+    {
+        groups.serial_valid = true;
+        groups.serial_group_id = (static_cast<uint64_t>(1) << 32) + group_id;
+        return groups.serial_group_id;
+    }
+
+    const uint64_t delta = (group_id - groups.serial_group_id) & (group_id_range - 1);
+    if (delta < group_id_range / 2)
+    {
+        groups.serial_group_id += delta;
+        return groups.serial_group_id;
+    }
+
+    return groups.serial_group_id - (group_id_range - delta);
+}
+
+static void store_group_block(std::list<block_buffer_t> & block_list, const block_head_t & block_head, const block_format_t & block_format, const void * data, uint32_t size)
+{
+    block_list.emplace_back();
+    block_list.back().assign(reinterpret_cast<const uint8_t *>(data) + block_format.head_size, size - block_format.head_size, 0);
+    block_list.back().block_id = block_head.block_id;
+}
+
+/*
+ * all blocks of a group have the same size, only the last original block may be shorter,
+ * its missing tail is zero padding, the full size is known once any other block arrives
+ */
+static bool match_block_size(group_head_t & group_head, const block_head_t & block_head, uint32_t block_size)
+{
+    if (block_head.block_id + 1 == block_head.original_count)
+    {
+        return block_size <= group_head.block_size || !group_head.block_size_known;
+    }
+
+    if (group_head.block_size_known)
+    {
+        return block_size == group_head.block_size;
+    }
+
+    if (block_size < group_head.block_size)
+    {
+        return false;
+    }
+
+    group_head.block_size = block_size;
+    group_head.block_size_known = true;
+
+    return true;
+}
+
+static void count_lost_blocks(receive_report_t & report, uint32_t lost_count)
+{
+    if (0 == lost_count)
+    {
+        return;
+    }
+
+    uint32_t bucket = 0;
+    while (bucket + 1 < sizeof(report.burst_histogram) / sizeof(report.burst_histogram[0]) && lost_count > (1U << bucket))
+    {
+        ++bucket;
+    }
+    report.burst_histogram[bucket] += 1;
+}
+
+/*
+ * a block behind the next expected block id closes a run of lost blocks, blocks are sent in block id order
+ */
+static void count_group_block(receive_report_t & report, group_head_t & group_head, uint8_t block_id)
+{
+    report.received_blocks += 1;
+    if (block_id >= group_head.original_count + group_head.recovery_count)
+    {
+        report.expected_blocks += 1;
+    }
+    else if (block_id >= group_head.next_block_id)
+    {
+        count_lost_blocks(report, block_id - group_head.next_block_id);
+        group_head.next_block_id = block_id + 1;
+    }
+}
+
+/*
+ * transit is the arrival time of the first block of a group less its sender timestamp, clock offset included,
+ * it is kept as the first transit seen and the smoothed difference to it, jitter is the smoothed deviation from that
+ */
+static void update_transit(groups_t & groups, uint32_t timestamp, uint32_t arrival)
+{
+    const uint32_t transit = arrival - timestamp;
+    if (!groups.transit_valid)
+    {
+        groups.transit_valid = true;
+        groups.transit_base = transit;
+        groups.transit_delta = 0.0;
+        groups.jitter = 0.0;
+        return;
+    }
+
+    const double transit_delta = static_cast<int32_t>(transit - groups.transit_base);
+    groups.jitter += (fabs(transit_delta - groups.transit_delta) - groups.jitter) / 16.0;
+    groups.transit_delta += (transit_delta - groups.transit_delta) / 16.0;
+}
+
+/*
+ * a group with sender timestamp is due when its last block should have arrived: timestamp, transit, duration and four times the jitter
+ */
+static uint32_t due_timestamp(const groups_t & groups, uint32_t timestamp, uint16_t duration)
+{
+    return timestamp + groups.transit_base + static_cast<uint32_t>(static_cast<int32_t>(groups.transit_delta + 0.5)) + duration + static_cast<uint32_t>(groups.jitter * 4.0 + 0.5);
+}
+
+/*
+ * a group with sender timestamp expires max_delay_microseconds after it was due,
+ * a group without one expires max_delay_microseconds after its first block (twice that for large groups)
+ */
+static void make_decode_timer(groups_t & groups, const block_format_t & block_format, const group_head_t & group_head, uint64_t current_time, uint32_t max_delay_microseconds, decode_timer_t & decode_timer)
+{
+    int64_t delay_microseconds = static_cast<int64_t>(max_delay_microseconds) * (group_head.original_count > 100 ? 2 : 1);
+    if (0 != (block_format.flags & s_compact_flag_timestamp))
+    {
+        const uint32_t arrival = static_cast<uint32_t>(current_time / 1000);
+        update_transit(groups, block_format.timestamp, arrival);
+
+        const uint32_t due = due_timestamp(groups, block_format.timestamp, block_format.duration);
+        delay_microseconds = static_cast<int64_t>(static_cast<int32_t>(due - arrival)) * 1000 + max_delay_microseconds;
+    }
+
+    decode_timer.decode_time = static_cast<uint64_t>(std::max<int64_t>(static_cast<int64_t>(current_time) + delay_microseconds, 0));
+}
+
+static bool insert_group_block(const void * data, uint32_t size, groups_t & groups, uint64_t current_time, uint32_t max_delay_microseconds, uint32_t nack_delay_microseconds)
+{
+    block_head_t new_block_head = { 0x0 };
+    block_format_t new_block_format = { 0x0 };
+    if (!read_block_head(reinterpret_cast<const uint8_t *>(data), size, new_block_head, new_block_format))
+    {
+        add_counter(groups.counters.invalid_packets, 1);
+        return false;
+    }
+
+    if (s_protocol == new_block_format.protocol && new_block_head.block_id < new_block_head.original_count)
+    {
+        block_body_t new_block_body = *reinterpret_cast<const block_body_t *>(reinterpret_cast<const uint8_t *>(data) + sizeof(block_head_t));
+        new_block_body.decode();
+
+        if (0 == new_block_body.frame_count || new_block_body.frame_index >= new_block_body.frame_count || sizeof(block_t) + new_block_body.block_bytes > size)
+        {
+            add_counter(groups.counters.invalid_packets, 1);
+            return false;
+        }
+    }
+
+    new_block_head.group_id = expand_group_id(groups, new_block_head.group_id, new_block_format.group_id_bits);
+
+    CAUCHY_FEC_PROBE5(block_insert, new_block_head.group_id, new_block_head.block_id, new_block_head.original_count, new_block_head.recovery_count, size - new_block_format.head_size);
+
+    if (new_block_head.group_id < groups.min_group_id)
+    {
+        groups.report.received_blocks += 1;
+        add_counter(groups.counters.stale_packets, 1);
+        return false;
+    }
+
+    const uint32_t new_block_size = size - new_block_format.head_size;
+
+    groups.new_group_id = new_block_head.group_id;
+
+    group_src_t & group_src = groups.src_item[groups.new_group_id];
+    group_head_t & group_head = group_src.head;
+    group_body_t & group_body = group_src.body;
+
+    if (0 == group_head.block_count)
+    {
+        if (0 == group_head.original_count ||
+            new_block_size != group_head.block_size ||
+            new_block_format.protocol != group_head.protocol ||
+            new_block_head.group_id != group_head.group_id ||
+            new_block_head.original_count != group_head.original_count || new_block_head.recovery_count != group_head.recovery_count)
+        {
+            group_head.block_size = new_block_size;
+            group_head.block_size_known = (new_block_head.block_id + 1 != new_block_head.original_count);
+            group_head.group_id = new_block_head.group_id;
+            group_head.protocol = new_block_format.protocol;
+            group_head.group_id_bits = static_cast<uint8_t>(new_block_format.group_id_bits);
+            group_head.original_count = new_block_head.original_count;
+            group_head.recovery_count = new_block_head.recovery_count;
+            group_head.next_block_id = 0;
+            group_head.timestamped = (0 != (new_block_format.flags & s_compact_flag_timestamp));
+            group_head.timestamp = new_block_format.timestamp;
+            group_head.duration = new_block_format.duration;
+            group_head.buffered_bytes = new_block_size;
+            group_head.first_time = current_time;
+            memset(group_head.block_bitmap, 0x0, sizeof(group_head.block_bitmap));
+            group_head.block_bitmap[new_block_head.block_id >> 3] |= (1 << (new_block_head.block_id & 7));
+            if (new_block_head.block_id < new_block_head.original_count)
+            {
+                store_group_block(group_body.original_list, new_block_head, new_block_format, data, size);
+            }
+            else
+            {
+                store_group_block(group_body.recovery_list, new_block_head, new_block_format, data, size);
+            }
+            group_head.block_count += 1;
+            groups.buffered_bytes += new_block_size;
+
+            groups.report.expected_blocks += group_head.original_count + group_head.recovery_count;
+            count_group_block(groups.report, group_head, new_block_head.block_id);
+
+            decode_timer_t decode_timer = { 0x0 };
+            decode_timer.group_id = new_block_head.group_id;
+            make_decode_timer(groups, new_block_format, group_head, current_time, max_delay_microseconds, decode_timer);
+            decode_timer.nack_time = current_time + nack_delay_microseconds;
+
+            /* keep the timers in group id order, the groups of an interleaved stream do not start in order */
+            std::list<decode_timer_t>::reverse_iterator position = groups.decode_timer_list.rbegin();
+            while (groups.decode_timer_list.rend() != position && position->group_id > decode_timer.group_id)
+            {
+                ++position;
+            }
+            groups.decode_timer_list.insert(position.base(), decode_timer);
+
+            return true;
+        }
+        else
+        {
+            add_counter(groups.counters.duplicate_packets, 1);
+            return false;
+        }
+    }
+    else
+    {
+        if (new_block_format.protocol != group_head.protocol ||
+            new_block_head.group_id != group_head.group_id ||
+            new_block_head.original_count != group_head.original_count || new_block_head.recovery_count != group_head.recovery_count)
+        {
+            add_counter(groups.counters.invalid_packets, 1);
+            return false;
+        }
+
+        if (group_head.block_bitmap[new_block_head.block_id >> 3] & (1 << (new_block_head.block_id & 7)))
+        {
+            add_counter(groups.counters.duplicate_packets, 1);
+            return false;
+        }
+
+        if (!match_block_size(group_head, new_block_head, new_block_size))
+        {
+            add_counter(groups.counters.invalid_packets, 1);
+            return false;
+        }
+
+        count_group_block(groups.report, group_head, new_block_head.block_id);
+    }
+
+    if (group_head.block_count == group_head.original_count)
+    {
+        if (new_block_head.block_id < new_block_head.original_count)
+        {
+            const uint8_t old_block_id = group_body.recovery_list.back().block_id;
+            group_head.block_bitmap[old_block_id >> 3] &= ~(1 << (old_block_id & 7));
+            group_head.buffered_bytes -= group_body.recovery_list.back().size;
+            groups.buffered_bytes -= group_body.recovery_list.back().size;
+            group_body.recovery_list.pop_back();
+            group_head.block_bitmap[new_block_head.block_id >> 3] |= (1 << (new_block_head.block_id & 7));
+            store_group_block(group_body.original_list, new_block_head, new_block_format, data, size);
+            group_head.buffered_bytes += new_block_size;
+            groups.buffered_bytes += new_block_size;
+        }
+    }
+    else
+    {
+        group_head.block_bitmap[new_block_head.block_id >> 3] |= (1 << (new_block_head.block_id & 7));
+        if (new_block_head.block_id < new_block_head.original_count)
+        {
+            store_group_block(group_body.original_list, new_block_head, new_block_format, data, size);
+        }
+        else
+        {
+            store_group_block(group_body.recovery_list, new_block_head, new_block_format, data, size);
+        }
+        group_head.block_count += 1;
+        group_head.buffered_bytes += new_block_size;
+        groups.buffered_bytes += new_block_size;
+    }
+
+    return true;
+}
+
+/*
+ * frame sizes come from the wire, a frame that alone is over the budget is not allocated at all
+ */
+static bool frame_over_budget(const groups_t & groups, uint32_t frame_size)
+{
+    return 0 != groups.max_buffered_bytes && frame_size > groups.max_buffered_bytes;
+}
+
+static group_dst_t * acquire_group_dst(groups_t & groups, const group_head_t & group_head, const record_head_t & record_head, uint64_t & min_group_id, uint64_t & max_group_id)
+{
+    if (0 == record_head.frame_count || record_head.frame_index >= record_head.frame_count || group_head.group_id < record_head.frame_index ||
+        static_cast<uint64_t>(record_head.frame_offset) + record_head.bytes > record_head.frame_size)
+    {
+        return nullptr;
+    }
+
+    if (frame_over_budget(groups, record_head.frame_size))
+    {
+        return nullptr;
+    }
+
+    const uint64_t record_min_group_id = group_head.group_id - record_head.frame_index;
+    const uint64_t record_max_group_id = record_min_group_id + record_head.frame_count;
+
+    if (0 == max_group_id)
+    {
+        min_group_id = record_min_group_id;
+        max_group_id = record_max_group_id;
+    }
+    else if (min_group_id != record_min_group_id || max_group_id != record_max_group_id)
+    {
+        return nullptr;
+    }
+
+    group_dst_t & group_dst = groups.dst_item[max_group_id - 1];
+    if (group_dst.data.empty())
+    {
+        group_dst.min_group_id = min_group_id;
+        group_dst.max_group_id = max_group_id;
+        group_dst.group_status.resize(static_cast<uint32_t>(max_group_id - min_group_id));
+        group_dst.data.resize(record_head.frame_size);
+        group_dst.valid_ranges.clear();
+        group_dst.first_time = group_head.first_time;
+        groups.buffered_bytes -= group_dst.buffered_bytes;
+        groups.buffered_bytes += record_head.frame_size;
+        group_dst.buffered_bytes = record_head.frame_size;
+        group_dst.timestamped = group_head.timestamped;
+        group_dst.timestamp = group_head.timestamp;
+        group_dst.duration = group_head.duration;
+    }
+    else if (group_dst.min_group_id != min_group_id || group_dst.max_group_id != max_group_id || group_dst.data.size() != record_head.frame_size)
+    {
+        return nullptr;
+    }
+    else
+    {
+        group_dst.first_time = std::min<uint64_t>(group_dst.first_time, group_head.first_time);
+    }
+
+    return &group_dst;
+}
+
+static bool decode_standard_block(const group_head_t & group_head, uint8_t block_id, uint8_t * block, uint32_t block_bytes, groups_t & groups, uint64_t & min_group_id, uint64_t & max_group_id)
+{
+    block_body_t * block_body = reinterpret_cast<block_body_t *>(block);
+    block_body->decode();
+
+    /* a shortened last block tells nothing about the full block size, but it ends the frame */
+    const bool last_block = (block_body->frame_index + 1 == block_body->frame_count && block_id + 1 == group_head.original_count);
+    const uint64_t frame_offset = (last_block && block_body->block_bytes <= block_body->frame_size ? block_body->frame_size - block_body->block_bytes : static_cast<uint64_t>(block_body->block_index) * block_bytes);
+    record_head_t record_head = { block_body->frame_size, static_cast<uint32_t>(frame_offset), block_body->frame_index, block_body->frame_count, block_body->block_bytes };
+
+    group_dst_t * group_dst = (block_body->block_bytes <= block_bytes && frame_offset <= block_body->frame_size ? acquire_group_dst(groups, group_head, record_head, min_group_id, max_group_id) : nullptr);
+    if (nullptr == group_dst)
+    {
+        return false;
+    }
+
+    if (0 != record_head.bytes)
+    {
+        memcpy(&group_dst->data[record_head.frame_offset], block + sizeof(block_body_t), record_head.bytes);
+        group_dst->validate(record_head.frame_offset, record_head.bytes);
+    }
+
+    return true;
+}
+
+static bool decode_standard_records(const group_head_t & group_head, CM256::cm256_block * blocks, groups_t & groups, uint64_t & min_group_id, uint64_t & max_group_id)
+{
+    const uint32_t block_bytes = static_cast<uint32_t>(group_head.block_size - sizeof(block_body_t));
+
+    for (uint32_t block_id = 0; block_id < group_head.original_count; ++block_id)
+    {
+        if (!decode_standard_block(group_head, blocks[block_id].Index, reinterpret_cast<uint8_t *>(blocks[block_id].Block), block_bytes, groups, min_group_id, max_group_id))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool decode_compact_records(const group_head_t & group_head, CM256::cm256_block * blocks, groups_t & groups, std::list<std::vector<uint8_t>> & frame_list, uint64_t & min_group_id, uint64_t & max_group_id)
+{
+    uint8_t * coded_blocks[256] = { 0x0 };
+
+    for (uint32_t block_id = 0; block_id < group_head.original_count; ++block_id)
+    {
+        if (blocks[block_id].Index >= group_head.original_count || nullptr != coded_blocks[blocks[block_id].Index])
+        {
+            return false;
+        }
+        coded_blocks[blocks[block_id].Index] = reinterpret_cast<uint8_t *>(blocks[block_id].Block);
+    }
+
+    group_stream_t group_stream(coded_blocks, group_head.original_count, group_head.block_size);
+
+    uint32_t record_count = 0;
+    while (true)
+    {
+        record_head_t record_head = { 0x0 };
+        if (!group_stream.read_record(record_head))
+        {
+            return false;
+        }
+        if (0 == record_head.frame_size)
+        {
+            break;
+        }
+
+        /* a whole frame in one record, e.g. one of several aggregated small frames, needs no reassembly, its data must be in the stream */
+        if (1 == record_head.frame_count && 0 == record_head.frame_offset && record_head.bytes == record_head.frame_size)
+        {
+            if (record_head.bytes > group_stream.remain() || frame_over_budget(groups, record_head.frame_size))
+            {
+                return false;
+            }
+            frame_list.emplace_back(std::vector<uint8_t>(record_head.frame_size));
+            if (!group_stream.read(&frame_list.back()[0], record_head.bytes))
+            {
+                return false;
+            }
+            ++record_count;
+            continue;
+        }
+
+        group_dst_t * group_dst = acquire_group_dst(groups, group_head, record_head, min_group_id, max_group_id);
+        if (nullptr == group_dst)
+        {
+            return false;
+        }
+
+        if (0 != record_head.bytes && !group_stream.read(&group_dst->data[record_head.frame_offset], record_head.bytes))
+        {
+            return false;
+        }
+        group_dst->validate(record_head.frame_offset, record_head.bytes);
+
+        ++record_count;
+    }
+
+    return 0 != record_count;
+}
+
+/*
+ * the originals of a group that cannot be decoded still carry frame data:
+ * a standard block describes itself, the record stream of a compact group is readable from its start up to the first missing block
+ */
+static void salvage_standard_records(const group_head_t & group_head, group_body_t & group_body, groups_t & groups, uint64_t & min_group_id, uint64_t & max_group_id)
+{
+    for (std::list<block_buffer_t>::iterator iter = group_body.original_list.begin(); group_body.original_list.end() != iter; ++iter)
+    {
+        block_buffer_t & buffer = *iter;
+
+        /* only the last original block may be shortened, the others have the full size */
+        const bool last_block = (buffer.block_id + 1 == group_head.original_count);
+        if (last_block && !group_head.block_size_known)
+        {
+            block_body_t block_body = *reinterpret_cast<const block_body_t *>(buffer.coded());
+            block_body.decode();
+            if (block_body.frame_index + 1 != block_body.frame_count)
+            {
+                continue;
+            }
+        }
+
+        const uint32_t block_bytes = static_cast<uint32_t>((last_block && group_head.block_size_known ? group_head.block_size : buffer.size) - sizeof(block_body_t));
+        if (!decode_standard_block(group_head, buffer.block_id, buffer.coded(), block_bytes, groups, min_group_id, max_group_id))
+        {
+            return;
+        }
+    }
+}
+
+static void salvage_compact_records(const group_head_t & group_head, group_body_t & group_body, groups_t & groups, std::list<std::vector<uint8_t>> & frame_list, uint64_t & min_group_id, uint64_t & max_group_id)
+{
+    uint8_t * coded_blocks[256] = { 0x0 };
+    uint32_t block_sizes[256] = { 0x0 };
+
+    for (std::list<block_buffer_t>::iterator iter = group_body.original_list.begin(); group_body.original_list.end() != iter; ++iter)
+    {
+        coded_blocks[iter->block_id] = iter->coded();
+        block_sizes[iter->block_id] = iter->size;
+    }
+
+    uint32_t block_count = 0;
+    while (block_count < group_head.original_count && nullptr != coded_blocks[block_count] && block_sizes[block_count] == block_sizes[0])
+    {
+        ++block_count;
+    }
+
+    if (0 == block_count)
+    {
+        return;
+    }
+
+    group_stream_t group_stream(coded_blocks, block_count, block_sizes[0]);
+
+    while (true)
+    {
+        record_head_t record_head = { 0x0 };
+        if (!group_stream.read_record(record_head) || 0 == record_head.frame_size)
+        {
+            break;
+        }
+
+        const uint32_t bytes = static_cast<uint32_t>(std::min<uint64_t>(record_head.bytes, group_stream.remain()));
+
+        if (1 == record_head.frame_count && 0 == record_head.frame_offset && record_head.bytes == record_head.frame_size && bytes == record_head.bytes)
+        {
+            if (frame_over_budget(groups, record_head.frame_size))
+            {
+                break;
+            }
+            frame_list.emplace_back(std::vector<uint8_t>(record_head.frame_size));
+            group_stream.read(&frame_list.back()[0], bytes);
+            continue;
+        }
+
+        group_dst_t * group_dst = acquire_group_dst(groups, group_head, record_head, min_group_id, max_group_id);
+        if (nullptr == group_dst)
+        {
+            break;
+        }
+
+        if (0 != bytes)
+        {
+            group_stream.read(&group_dst->data[record_head.frame_offset], bytes);
+            group_dst->validate(record_head.frame_offset, bytes);
+        }
+
+        if (bytes != record_head.bytes)
+        {
+            break;
+        }
+    }
+}
+
+static void salvage_group(const group_head_t & group_head, group_body_t & group_body, groups_t & groups, std::list<std::vector<uint8_t>> & frame_list)
+{
+    uint64_t min_group_id = 0;
+    uint64_t max_group_id = 0;
+
+    if (s_compact_protocol == group_head.protocol)
+    {
+        salvage_compact_records(group_head, group_body, groups, frame_list, min_group_id, max_group_id);
+    }
+    else
+    {
+        salvage_standard_records(group_head, group_body, groups, min_group_id, max_group_id);
+    }
+}
+
+static bool cm256_decode_group(CM256 & cm256, group_head_t & group_head, group_body_t & group_body, groups_t & groups, std::list<std::vector<uint8_t>> & frame_list, uint64_t & min_group_id, uint64_t & max_group_id)
+{
+    min_group_id = 0;
+    max_group_id = 0;
+
+    if (group_body.original_list.size() + group_body.recovery_list.size() != group_head.original_count)
+    {
+        return false;
+    }
+
+    const bool recovery = !group_body.recovery_list.empty();
+
+    /* repair blocks have block ids behind the recovery blocks, the decoder has to know the highest one */
+    uint32_t recovery_count = group_head.recovery_count;
+    for (std::list<block_buffer_t>::const_iterator iter = group_body.recovery_list.begin(); group_body.recovery_list.end() != iter; ++iter)
+    {
+        recovery_count = std::max<uint32_t>(recovery_count, iter->block_id + 1 - group_head.original_count);
+    }
+
+    std::list<block_buffer_t> src_data_list;
+    src_data_list.splice(src_data_list.end(), group_body.original_list);
+    src_data_list.splice(src_data_list.end(), group_body.recovery_list);
+
+    if (src_data_list.empty())
+    {
+        return false;
+    }
+
+    CM256::cm256_block blocks[256];
+
+    uint32_t block_id = 0;
+    for (std::list<block_buffer_t>::iterator iter = src_data_list.begin(); src_data_list.end() != iter; ++iter)
+    {
+        block_buffer_t & buffer = *iter;
+        buffer.extend(group_head.block_size);
+        blocks[block_id].Block = buffer.coded();
+        blocks[block_id].Index = buffer.block_id;
+        ++block_id;
+    }
+
+    if (recovery)
+    {
+        if (!cm256.isInitialized())
+        {
+            return false;
+        }
+
+        CM256::cm256_encoder_params params = { group_head.original_count, static_cast<int>(recovery_count), static_cast<int>(cache_line_align(group_head.block_size)) };
+        const uint64_t decode_begin = get_steady_nanoseconds();
+        const int decode_result = cm256.cm256_decode(params, blocks);
+        record_histogram(groups.counters.decode_time, get_steady_nanoseconds() - decode_begin);
+        if (0 != decode_result)
+        {
+            return false;
+        }
+    }
+
+    bool decoded = false;
+    if (s_compact_protocol == group_head.protocol)
+    {
+        decoded = decode_compact_records(group_head, blocks, groups, frame_list, min_group_id, max_group_id);
+    }
+    else
+    {
+        decoded = decode_standard_records(group_head, blocks, groups, min_group_id, max_group_id);
+    }
+
+    if (!decoded)
+    {
+        frame_list.clear();
+    }
+
+    if (0 != max_group_id)
+    {
+        group_dst_t & group_dst = groups.dst_item[max_group_id - 1];
+        if (!decoded)
+        {
+            group_dst.data.clear();
+            groups.buffered_bytes -= group_dst.buffered_bytes;
+            group_dst.buffered_bytes = 0;
+            return false;
+        }
+
+        group_dst.group_status[static_cast<uint32_t>(group_head.group_id - min_group_id)] = true;
+    }
+
+    return decoded;
+}
+
+static void remove_expired_blocks(groups_t & groups)
+{
+    std::map<uint64_t, group_src_t> & src_item = groups.src_item;
+    for (std::map<uint64_t, group_src_t>::iterator iter = src_item.begin(); src_item.end() != iter; iter = src_item.erase(iter))
+    {
+        if (iter->first >= groups.min_group_id)
+        {
+            break;
+        }
+        groups.buffered_bytes -= iter->second.head.buffered_bytes;
+    }
+
+    std::map<uint64_t, group_dst_t> & dst_item = groups.dst_item;
+    for (std::map<uint64_t, group_dst_t>::iterator iter = dst_item.begin(); dst_item.end() != iter; iter = dst_item.erase(iter))
+    {
+        if (iter->first >= groups.min_group_id)
+        {
+            break;
+        }
+        groups.buffered_bytes -= iter->second.buffered_bytes;
+    }
+}
+
+static void evict_frame(groups_t & groups)
+{
+    std::map<uint64_t, group_dst_t>::iterator victim = groups.dst_item.begin();
+    add_counter(groups.counters.evicted_frames, 1);
+    add_counter(groups.counters.evicted_bytes, victim->second.buffered_bytes);
+    groups.buffered_bytes -= victim->second.buffered_bytes;
+    groups.dst_item.erase(victim);
+}
+
+/*
+ * over the group or byte budget the oldest group goes first, as it holds back all groups behind it anyway,
+ * it is lost as if none of its blocks had arrived: min_group_id moves past it, so its late blocks are stale and do not rebuild it,
+ * and the frames in assembly that needed it go with it, other frames in assembly go oldest first once no group is left,
+ * both maps are ordered by group id, so a victim is found at their front and its timer at the front of decode_timer_list
+ */
+static void evict_groups(groups_t & groups)
+{
+    while ((0 != groups.max_buffered_groups && groups.decode_timer_list.size() > groups.max_buffered_groups) ||
+           (0 != groups.max_buffered_bytes && groups.buffered_bytes > groups.max_buffered_bytes))
+    {
+        std::map<uint64_t, group_src_t>::iterator victim = groups.src_item.begin();
+        while (groups.src_item.end() != victim && 0 == victim->second.head.block_count)
+        {
+            ++victim;
+        }
+
+        if (groups.src_item.end() != victim)
+        {
+            const uint64_t group_id = victim->first;
+            const group_head_t & group_head = victim->second.head;
+            for (std::list<decode_timer_t>::iterator iter = groups.decode_timer_list.begin(); groups.decode_timer_list.end() != iter; ++iter)
+            {
+                if (iter->group_id == group_id)
+                {
+                    groups.decode_timer_list.erase(iter);
+                    break;
+                }
+            }
+
+            groups.report.lost_groups += 1;
+            add_counter(groups.counters.evicted_groups, 1);
+            add_counter(groups.counters.evicted_bytes, group_head.buffered_bytes);
+            groups.buffered_bytes -= group_head.buffered_bytes;
+            groups.src_item.erase(victim);
+            groups.min_group_id = std::max<uint64_t>(groups.min_group_id, group_id + 1);
+
+            while (!groups.dst_item.empty() && groups.dst_item.begin()->second.min_group_id <= group_id)
+            {
+                evict_frame(groups);
+            }
+        }
+        else if (!groups.dst_item.empty())
+        {
+            evict_frame(groups);
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+/*
+ * where decoded frames go: a callback or dst_list, range_list and partial_callback take validity maps,
+ * a partial frame is dropped for a destination without one
+ */
+struct decode_output_t
+{
+    std::list<std::vector<uint8_t>> &           dst_list;
+    std::list<std::vector<frame_range_t>> *     range_list;
+    decode_callback_t                           decode_callback;
+    partial_decode_callback_t                   partial_callback;
+    void *                                      user_data;
+    decode_counter_t *                          counters;
+
+    decode_output_t(std::list<std::vector<uint8_t>> & output_dst_list, std::list<std::vector<frame_range_t>> * output_range_list, decode_callback_t output_decode_callback, partial_decode_callback_t output_partial_callback, void * output_user_data)
+        : dst_list(output_dst_list)
+        , range_list(output_range_list)
+        , decode_callback(output_decode_callback)
+        , partial_callback(output_partial_callback)
+        , user_data(output_user_data)
+        , counters(nullptr)
+    {
+
+    }
+};
+
+/*
+ * valid_ranges is empty for a complete frame
+ */
+static std::size_t output_frame(std::vector<uint8_t> & frame, std::vector<frame_range_t> & valid_ranges, uint64_t first_time, uint64_t current_time, decode_output_t & output)
+{
+    const bool partial = !valid_ranges.empty();
+    const bool dropped = (partial && nullptr == output.range_list && nullptr == output.partial_callback);
+    const uint64_t wait_microseconds = current_time - std::min<uint64_t>(first_time, current_time);
+    if (nullptr != output.counters)
+    {
+        if (dropped)
+        {
+            add_counter(output.counters->dropped_frames, 1);
+        }
+        else
+        {
+            add_counter(output.counters->output_frames, 1);
+            add_counter(output.counters->output_bytes, frame.size());
+            add_counter(output.counters->partial_frames, partial ? 1 : 0);
+            record_histogram(output.counters->frame_latency, wait_microseconds);
+        }
+    }
+    if (!dropped)
+    {
+        CAUCHY_FEC_PROBE3(frame_deliver, frame.size(), valid_ranges.size(), wait_microseconds);
+    }
+
+    if (!partial && (nullptr != output.range_list || nullptr != output.partial_callback))
+    {
+        valid_ranges.push_back(frame_range_t(0, static_cast<uint32_t>(frame.size())));
+    }
+
+    if (nullptr != output.partial_callback)
+    {
+        (*output.partial_callback)(output.user_data, &frame[0], static_cast<uint32_t>(frame.size()), &valid_ranges[0], static_cast<uint32_t>(valid_ranges.size()));
+    }
+    else if (nullptr != output.range_list)
+    {
+        output.dst_list.emplace_back(std::move(frame));
+        output.range_list->emplace_back(std::move(valid_ranges));
+    }
+    else if (partial)
+    {
+        return 0;
+    }
+    else if (nullptr != output.decode_callback)
+    {
+        (*output.decode_callback)(output.user_data, &frame[0], static_cast<uint32_t>(frame.size()));
+    }
+    else
+    {
+        output.dst_list.emplace_back(std::move(frame));
+    }
+
+    return 1;
+}
+
+static bool less_frame_range(const frame_range_t & lhs, const frame_range_t & rhs)
+{
+    return lhs.offset < rhs.offset;
+}
+
+static void merge_valid_ranges(std::vector<frame_range_t> & valid_ranges)
+{
+    std::sort(valid_ranges.begin(), valid_ranges.end(), less_frame_range);
+
+    std::size_t count = 0;
+    for (std::size_t index = 0; index < valid_ranges.size(); ++index)
+    {
+        if (0 != count && valid_ranges[count - 1].offset + valid_ranges[count - 1].size >= valid_ranges[index].offset)
+        {
+            const uint32_t range_end = std::max<uint32_t>(valid_ranges[count - 1].offset + valid_ranges[count - 1].size, valid_ranges[index].offset + valid_ranges[index].size);
+            valid_ranges[count - 1].size = range_end - valid_ranges[count - 1].offset;
+        }
+        else
+        {
+            valid_ranges[count++] = valid_ranges[index];
+        }
+    }
+    valid_ranges.resize(count);
+}
+
+struct playout_frame_t
+{
+    std::vector<uint8_t>                data;
+    std::vector<frame_range_t>          valid_ranges;
+    uint64_t                            first_time;
+    uint64_t                            release_time;
+};
+
+struct playout_t
+{
+    std::list<playout_frame_t>          frame_list;
+    playout_stats_t                     stats;
+
+    playout_t()
+        : frame_list()
+        , stats()
+    {
+
+    }
+
+    void reset()
+    {
+        frame_list.clear();
+        stats = playout_stats_t();
+    }
+};
+
+/*
+ * a frame with a timestamp (the one of the first group of the frame that arrived) is held until playout_delay_microseconds after it was due,
+ * no frame is released before a frame held ahead of it, late frames, frames too far ahead (the transit estimate is off)
+ * and frames without timestamp are released as soon as the frames ahead of them are,
+ * returns the frames output at once because the playout stage is off or nothing is held
+ */
+static std::size_t playout_frame(const groups_t & groups, bool timestamped, uint32_t timestamp, uint16_t duration, std::vector<uint8_t> & frame, std::vector<frame_range_t> & valid_ranges, uint64_t first_time, uint64_t current_time, uint32_t playout_delay_microseconds, playout_t & playout, decode_output_t & output)
+{
+    if (0 == playout_delay_microseconds || (!timestamped && playout.frame_list.empty()))
+    {
+        return output_frame(frame, valid_ranges, first_time, current_time, output);
+    }
+
+    uint64_t release_time = current_time;
+    if (timestamped)
+    {
+        const uint32_t due = due_timestamp(groups, timestamp, duration);
+        const int64_t wait_microseconds = static_cast<int64_t>(static_cast<int32_t>(due - static_cast<uint32_t>(current_time / 1000))) * 1000 + playout_delay_microseconds;
+        const uint32_t hold_microseconds = (due - timestamp - groups.transit_base - static_cast<uint32_t>(static_cast<int32_t>(groups.transit_delta + 0.5))) * 1000 + playout_delay_microseconds;
+
+        if (wait_microseconds < 0)
+        {
+            playout.stats.late_frames += 1;
+        }
+        else if (wait_microseconds > static_cast<int64_t>(hold_microseconds) * 2)
+        {
+            playout.stats.early_frames += 1;
+        }
+        else
+        {
+            release_time += static_cast<uint64_t>(wait_microseconds);
+        }
+        playout.stats.playout_delay = hold_microseconds / 1000;
+    }
+
+    if (!playout.frame_list.empty())
+    {
+        release_time = std::max<uint64_t>(release_time, playout.frame_list.back().release_time);
+    }
+
+    playout.frame_list.emplace_back();
+    playout.frame_list.back().data.swap(frame);
+    playout.frame_list.back().valid_ranges.swap(valid_ranges);
+    playout.frame_list.back().first_time = first_time;
+    playout.frame_list.back().release_time = release_time;
+
+    return 0;
+}
+
+static std::size_t release_frames(playout_t & playout, uint64_t current_time, decode_output_t & output)
+{
+    std::size_t release_count = 0;
+    while (!playout.frame_list.empty() && playout.frame_list.front().release_time <= current_time)
+    {
+        release_count += output_frame(playout.frame_list.front().data, playout.frame_list.front().valid_ranges, playout.frame_list.front().first_time, current_time, output);
+        playout.frame_list.pop_front();
+        playout.stats.released_frames += 1;
+    }
+
+    return release_count;
+}
+
+static void make_playout_stats(const playout_t & playout, uint64_t current_time, playout_stats_t & playout_stats)
+{
+    playout_stats = playout.stats;
+    playout_stats.held_frames = static_cast<uint32_t>(playout.frame_list.size());
+    if (!playout.frame_list.empty())
+    {
+        const uint64_t release_time = playout.frame_list.front().release_time;
+        playout_stats.wait_millisecond = (release_time > current_time ? static_cast<uint32_t>((release_time - current_time + 999) / 1000) : 0);
+    }
+}
+
+/*
+ * frames whose last group is below group_id are done, complete ones are output,
+ * incomplete ones only with partial_frames and a destination that takes validity maps
+ */
+static std::size_t output_done_frames(groups_t & groups, uint64_t group_id, uint64_t current_time, uint32_t playout_delay_microseconds, bool partial_frames, playout_t & playout, decode_output_t & output)
+{
+    std::size_t output_count = 0;
+
+    std::map<uint64_t, group_dst_t> & dst_item = groups.dst_item;
+    for (std::map<uint64_t, group_dst_t>::iterator iter = dst_item.begin(); dst_item.end() != iter && iter->first < group_id; iter = dst_item.erase(iter))
+    {
+        group_dst_t & group_dst = iter->second;
+        groups.buffered_bytes -= group_dst.buffered_bytes;
+        if (group_dst.data.empty())
+        {
+            continue;
+        }
+
+        if (group_dst.complete())
+        {
+            group_dst.valid_ranges.clear();
+        }
+        else if (partial_frames && !group_dst.valid_ranges.empty())
+        {
+            merge_valid_ranges(group_dst.valid_ranges);
+        }
+        else
+        {
+            add_counter(groups.counters.dropped_frames, 1);
+            continue;
+        }
+
+        output_count += playout_frame(groups, group_dst.timestamped, group_dst.timestamp, group_dst.duration, group_dst.data, group_dst.valid_ranges, group_dst.first_time, current_time, playout_delay_microseconds, playout, output);
+    }
+
+    return output_count;
+}
+
+static std::size_t output_group_frames(groups_t & groups, const group_head_t & group_head, std::list<std::vector<uint8_t>> & frame_list, uint64_t current_time, uint32_t playout_delay_microseconds, playout_t & playout, decode_output_t & output)
+{
+    std::size_t output_count = 0;
+
+    for (std::list<std::vector<uint8_t>>::iterator iter = frame_list.begin(); frame_list.end() != iter; ++iter)
+    {
+        std::vector<frame_range_t> valid_ranges;
+        output_count += playout_frame(groups, group_head.timestamped, group_head.timestamp, group_head.duration, *iter, valid_ranges, group_head.first_time, current_time, playout_delay_microseconds, playout, output);
+    }
+
+    return output_count;
+}
+
+static bool check_package(const uint8_t * data, uint32_t size)
+{
+    block_head_t block_head = { 0x0 };
+    block_format_t block_format = { 0x0 };
+    return read_block_head(data, size, block_head, block_format);
+}
+
+static bool cm256_decode(CM256 & cm256, const void * data, uint32_t size, groups_t & groups, playout_t & playout, uint64_t current_time, uint32_t max_delay_microseconds, uint32_t nack_delay_microseconds, uint32_t playout_delay_microseconds, bool partial_frames, decode_output_t & output)
+{
+    std::size_t output_count = release_frames(playout, current_time, output);
+
+    if (nullptr != data && 0 != size)
+    {
+        add_counter(groups.counters.input_packets, 1);
+        add_counter(groups.counters.input_bytes, size);
+
+        if (!insert_group_block(data, size, groups, current_time, max_delay_microseconds, nack_delay_microseconds))
+        {
+            return 0 != output_count;
+        }
+
+        evict_groups(groups);
+
+        std::map<uint64_t, group_src_t>::const_iterator group_iter = groups.src_item.find(groups.new_group_id);
+        if (groups.src_item.end() == group_iter || (group_iter->second.head.block_count != group_iter->second.head.original_count && groups.new_group_id == groups.min_group_id))
+        {
+            return 0 != output_count;
+        }
+    }
+
+    std::list<decode_timer_t>::iterator iter = groups.decode_timer_list.begin();
+    while (groups.decode_timer_list.end() != iter)
+    {
+        const decode_timer_t & decode_timer = *iter;
+        group_src_t & group_src = groups.src_item[decode_timer.group_id];
+        std::list<std::vector<uint8_t>> frame_list;
+        if (group_src.head.block_count == group_src.head.original_count)
+        {
+            output_count += output_done_frames(groups, decode_timer.group_id, current_time, playout_delay_microseconds, partial_frames, playout, output);
+
+            uint64_t min_group_id = 0;
+            uint64_t max_group_id = 0;
+            const std::size_t recovery_count = group_src.body.recovery_list.size();
+            CAUCHY_FEC_PROBE5(group_decode_start, group_src.head.group_id, group_src.head.original_count, group_src.head.recovery_count, group_src.head.block_size, recovery_count);
+            const bool decoded = cm256_decode_group(cm256, group_src.head, group_src.body, groups, frame_list, min_group_id, max_group_id);
+            CAUCHY_FEC_PROBE5(group_decode_end, group_src.head.group_id, group_src.head.original_count, group_src.head.recovery_count, decoded, frame_list.size());
+            if (decoded)
+            {
+                if (0 != recovery_count)
+                {
+                    groups.report.recovered_groups += 1;
+                    add_counter(groups.counters.recovered_groups, 1);
+                    add_counter(groups.counters.recovered_blocks, recovery_count);
+                }
+                else
+                {
+                    groups.report.complete_groups += 1;
+                    add_counter(groups.counters.complete_groups, 1);
+                }
+                record_histogram(groups.counters.group_latency, current_time - std::min<uint64_t>(group_src.head.first_time, current_time));
+            }
+            else
+            {
+                groups.report.lost_groups += 1;
+                add_counter(groups.counters.failed_groups, 1);
+            }
+        }
+        else if (decode_timer.decode_time < current_time)
+        {
+            output_count += output_done_frames(groups, decode_timer.group_id, current_time, playout_delay_microseconds, partial_frames, playout, output);
+
+            CAUCHY_FEC_PROBE5(group_expire, group_src.head.group_id, group_src.head.original_count, group_src.head.recovery_count, group_src.head.block_count, current_time - std::min<uint64_t>(group_src.head.first_time, current_time));
+            groups.report.lost_groups += 1;
+            add_counter(groups.counters.expired_groups, 1);
+            count_lost_blocks(groups.report, group_src.head.original_count + group_src.head.recovery_count - group_src.head.next_block_id);
+            if (partial_frames)
+            {
+                salvage_group(group_src.head, group_src.body, groups, frame_list);
+            }
+        }
+        else
+        {
+            break;
+        }
+
+        output_count += output_group_frames(groups, group_src.head, frame_list, current_time, playout_delay_microseconds, playout, output);
+        output_count += output_done_frames(groups, decode_timer.group_id + 1, current_time, playout_delay_microseconds, partial_frames, playout, output);
+        groups.buffered_bytes -= group_src.head.buffered_bytes;
+        groups.src_item.erase(decode_timer.group_id);
+        groups.min_group_id = decode_timer.group_id + 1;
+        iter = groups.decode_timer_list.erase(iter);
+    }
+
+    remove_expired_blocks(groups);
+    evict_groups(groups);
+
+    output_count += release_frames(playout, current_time, output);
+
+    return 0 != output_count;
+}
+
+/*
+ * nack packet, the first byte is s_nack_protocol, then one entry per incomplete group:
+ *     varint group_id (as on the wire), needed_count(1), varint deadline (milliseconds until the group expires)
+ */
+static void write_nack_varint(std::vector<uint8_t> & data, uint64_t value)
+{
+    do
+    {
+        data.push_back(static_cast<uint8_t>((value & 0x7f) | (value >= 0x80 ? 0x80 : 0x00)));
+        value >>= 7;
+    } while (0 != value);
+}
+
+static bool read_nack_varint(const uint8_t *& data, const uint8_t * data_end, uint64_t & value)
+{
+    value = 0;
+    for (uint32_t shift = 0; shift < 64 && data < data_end; shift += 7)
+    {
+        const uint8_t byte = *data++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (0 == (byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * a group gets its first nack nack_delay_microseconds after its first block and one more each nack_delay_microseconds until it expires
+ */
+static bool cm256_nack(groups_t & groups, uint64_t current_time, uint32_t nack_delay_microseconds, std::vector<uint8_t> & nack_data)
+{
+    nack_data.clear();
+
+    if (0 == nack_delay_microseconds)
+    {
+        return false;
+    }
+
+    for (std::list<decode_timer_t>::iterator iter = groups.decode_timer_list.begin(); groups.decode_timer_list.end() != iter; ++iter)
+    {
+        decode_timer_t & decode_timer = *iter;
+
+        if (decode_timer.nack_time > current_time || decode_timer.decode_time <= current_time)
+        {
+            continue;
+        }
+
+        std::map<uint64_t, group_src_t>::const_iterator group_iter = groups.src_item.find(decode_timer.group_id);
+        if (groups.src_item.end() == group_iter || group_iter->second.head.block_count >= group_iter->second.head.original_count)
+        {
+            continue;
+        }
+
+        const group_head_t & group_head = group_iter->second.head;
+        const uint64_t group_id_mask = (group_head.group_id_bits >= 64 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << group_head.group_id_bits) - 1);
+
+        if (nack_data.empty())
+        {
+            nack_data.push_back(s_nack_protocol);
+        }
+        write_nack_varint(nack_data, group_head.group_id & group_id_mask);
+        nack_data.push_back(static_cast<uint8_t>(group_head.original_count - group_head.block_count));
+        write_nack_varint(nack_data, (decode_timer.decode_time - current_time) / 1000);
+
+        decode_timer.nack_time += nack_delay_microseconds;
+    }
+
+    return !nack_data.empty();
+}
+
+static bool cm256_repair_nack(CM256 & cm256, const uint8_t * nack_data, uint32_t nack_size, repair_cache_t & repair_cache, std::vector<block_buffer_t> & buffers, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    if (nullptr == nack_data || 0 == nack_size || s_nack_protocol != nack_data[0])
+    {
+        return false;
+    }
+
+    const uint8_t * data = nack_data + 1;
+    const uint8_t * data_end = nack_data + nack_size;
+    while (data < data_end)
+    {
+        uint64_t group_id = 0;
+        uint64_t deadline = 0;
+        if (!read_nack_varint(data, data_end, group_id) || data == data_end)
+        {
+            return false;
+        }
+        const uint8_t needed_count = *data++;
+        if (!read_nack_varint(data, data_end, deadline))
+        {
+            return false;
+        }
+
+        /* a group that already left the cache cannot be repaired any more, the others of the nack still can */
+        cm256_repair(cm256, group_id, needed_count, repair_cache, buffers, dst_list, encode_callback, user_data);
+    }
+
+    return true;
+}
+
+/*
+ * like decode_counter_t, written by the encoding thread alone
+ */
+struct encode_counter_t
+{
+    std::atomic<uint64_t>               input_frames;
+    std::atomic<uint64_t>               input_bytes;
+    std::atomic<uint64_t>               output_packets;
+    std::atomic<uint64_t>               output_bytes;
+    std::atomic<uint64_t>               repair_packets;
+    histogram_counter_t                 encode_time;
+
+    encode_counter_t()
+        : input_frames(0)
+        , input_bytes(0)
+        , output_packets(0)
+        , output_bytes(0)
+        , repair_packets(0)
+        , encode_time()
+    {
+
+    }
+};
+
+/*
+ * packets to a callback are counted on their way through count_encode_callback(), packets to dst_list once the call returns
+ */
+struct encode_output_t
+{
+    encode_callback_t                   encode_callback;
+    void *                              user_data;
+    encode_counter_t &                  counters;
+    bool                                repair;
+    std::size_t                         list_size;
+
+    encode_output_t(encode_callback_t output_encode_callback, void * output_user_data, encode_counter_t & output_counters, bool output_repair, const std::list<std::vector<uint8_t>> & dst_list)
+        : encode_callback(output_encode_callback)
+        , user_data(output_user_data)
+        , counters(output_counters)
+        , repair(output_repair)
+        , list_size(dst_list.size())
+    {
+
     }
+};
 
-    remove_expired_blocks(groups);
+static void count_encode_packet(encode_output_t & output, uint32_t size)
+{
+    add_counter(output.counters.output_packets, 1);
+    add_counter(output.counters.output_bytes, size);
+    add_counter(output.counters.repair_packets, output.repair ? 1 : 0);
+}
+
+static void count_encode_callback(void * user_data, const uint8_t * dst_data, uint32_t dst_size)
+{
+    encode_output_t & output = *reinterpret_cast<encode_output_t *>(user_data);
+    count_encode_packet(output, dst_size);
+    (*output.encode_callback)(output.user_data, dst_data, dst_size);
+}
+
+static encode_callback_t counted_callback(const encode_output_t & output)
+{
+    return (nullptr != output.encode_callback ? count_encode_callback : nullptr);
+}
 
-    return new_dst_list_size > old_dst_list_size;
+static void count_encode_list(encode_output_t & output, const std::list<std::vector<uint8_t>> & dst_list)
+{
+    std::list<std::vector<uint8_t>>::const_reverse_iterator iter = dst_list.rbegin();
+    for (std::size_t index = output.list_size; index < dst_list.size(); ++index, ++iter)
+    {
+        count_encode_packet(output, static_cast<uint32_t>(iter->size()));
+    }
 }
 
 class CauchyFecEncoderImpl
 {
 public:
-    CauchyFecEncoderImpl(uint32_t max_block_size, double recovery_rate, bool force_recovery);
+    CauchyFecEncoderImpl(const encode_option_t & option);
     CauchyFecEncoderImpl(const CauchyFecEncoderImpl &) = delete;
     CauchyFecEncoderImpl(CauchyFecEncoderImpl &&) = delete;
     CauchyFecEncoderImpl & operator = (const CauchyFecEncoderImpl &) = delete;
@@ -771,26 +3594,56 @@ public:
 public:
     bool encode(const uint8_t * src_data, uint32_t src_size, std::list<std::vector<uint8_t>> & dst_list);
     bool encode(const uint8_t * src_data, uint32_t src_size, encode_callback_t encode_callback, void * user_data);
+    bool encode(const uint8_t * src_data, uint32_t src_size, const frame_option_t & frame_option, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data);
+
+public:
+    bool flush(std::list<std::vector<uint8_t>> & dst_list);
+    bool flush(encode_callback_t encode_callback, void * user_data);
+
+public:
+    bool get_stats(encode_stats_t & encode_stats);
+    bool get_counters(encode_counters_t & encode_counters) const;
+    bool get_latency(encode_latency_t & encode_latency) const;
+
+public:
+    bool feedback(const receive_report_t & receive_report);
+
+public:
+    bool repair(uint64_t group_id, uint32_t block_count, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data);
+    bool repair_nack(const uint8_t * nack_data, uint32_t nack_size, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data);
 
 public:
     void reset();
 
 private:
-    const uint32_t      m_max_block_size;
-    const double        m_recovery_rate;
-    const bool          m_force_recovery;
+    encode_option_t                 m_option;
 
 private:
-    uint64_t            m_group_id;
+    CM256                           m_cm256;
+    uint64_t                        m_group_id;
+    std::vector<block_buffer_t>     m_buffers;
+    repair_cache_t                  m_repair_cache;
+    aggregate_t                     m_aggregate;
+    interleave_t                    m_interleave;
+    encode_stats_t                  m_stats;
+    loss_model_t                    m_loss_model;
+    encode_counter_t                m_counters;
 };
 
-CauchyFecEncoderImpl::CauchyFecEncoderImpl(uint32_t max_block_size, double recovery_rate, bool force_recovery)
-    : m_max_block_size(std::max<uint32_t>(max_block_size, sizeof(block_t) + 1))
-    , m_recovery_rate(std::max<double>(std::min<double>(recovery_rate, 1.0), 0.0))
-    , m_force_recovery(force_recovery)
+CauchyFecEncoderImpl::CauchyFecEncoderImpl(const encode_option_t & option)
+    : m_option(option)
+    , m_cm256()
     , m_group_id(0)
+    , m_buffers()
+    , m_repair_cache()
+    , m_aggregate()
+    , m_interleave()
+    , m_stats()
+    , m_loss_model()
+    , m_counters()
 {
-
+    m_option.max_block_size = std::max<uint32_t>(m_option.max_block_size, sizeof(block_t) + 1);
+    m_option.recovery_rate = std::max<double>(std::min<double>(m_option.recovery_rate, 1.0), 0.0);
 }
 
 CauchyFecEncoderImpl::~CauchyFecEncoderImpl()
@@ -800,24 +3653,239 @@ CauchyFecEncoderImpl::~CauchyFecEncoderImpl()
 
 bool CauchyFecEncoderImpl::encode(const uint8_t * src_data, uint32_t src_size, std::list<std::vector<uint8_t>> & dst_list)
 {
-    return cm256_encode(src_data, src_size, std::min<uint32_t>(m_max_block_size, src_size + sizeof(block_t)), m_recovery_rate, m_force_recovery, m_group_id, dst_list, nullptr, nullptr);
+    return encode(src_data, src_size, frame_option_t(), dst_list, nullptr, nullptr);
 }
 
 bool CauchyFecEncoderImpl::encode(const uint8_t * src_data, uint32_t src_size, encode_callback_t encode_callback, void * user_data)
 {
     std::list<std::vector<uint8_t>> dst_list;
-    return cm256_encode(src_data, src_size, std::min<uint32_t>(m_max_block_size, src_size + sizeof(block_t)), m_recovery_rate, m_force_recovery, m_group_id, dst_list, encode_callback, user_data);
+    return encode(src_data, src_size, frame_option_t(), dst_list, encode_callback, user_data);
+}
+
+bool CauchyFecEncoderImpl::encode(const uint8_t * src_data, uint32_t src_size, const frame_option_t & frame_option, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    encode_option_t option = m_option;
+    if (0 != frame_option.max_original_count)
+    {
+        option.max_original_count = frame_option.max_original_count;
+    }
+    if (frame_option.recovery_rate >= 0.0)
+    {
+        option.recovery_rate = frame_option.recovery_rate;
+    }
+    else if (option.adaptive_recovery && 0 != m_loss_model.report_count)
+    {
+        option.recovery_rate = model_recovery_rate(m_loss_model, src_size, option);
+    }
+
+    const uint64_t encode_begin = get_steady_nanoseconds();
+    add_counter(m_counters.input_frames, 1);
+    add_counter(m_counters.input_bytes, src_size);
+
+    encode_output_t output(encode_callback, user_data, m_counters, false, dst_list);
+
+    /* an urgent frame pushes out what is held before it and is not held itself */
+    if (0 != frame_option.priority)
+    {
+        if (!cm256_flush(m_cm256, m_option, m_group_id, m_buffers, m_repair_cache, m_aggregate, m_interleave, m_stats, dst_list, counted_callback(output), &output))
+        {
+            count_encode_list(output, dst_list);
+            return false;
+        }
+        option.aggregate_bytes = 0;
+        option.interleave_millisecond = 0;
+    }
+
+    const bool ret = cm256_encode(m_cm256, src_data, src_size, option, frame_option, m_group_id, m_buffers, m_repair_cache, m_aggregate, m_interleave, m_stats, dst_list, counted_callback(output), &output);
+    count_encode_list(output, dst_list);
+    record_histogram(m_counters.encode_time, get_steady_nanoseconds() - encode_begin);
+    return ret;
+}
+
+bool CauchyFecEncoderImpl::flush(std::list<std::vector<uint8_t>> & dst_list)
+{
+    encode_output_t output(nullptr, nullptr, m_counters, false, dst_list);
+    const bool ret = cm256_flush(m_cm256, m_option, m_group_id, m_buffers, m_repair_cache, m_aggregate, m_interleave, m_stats, dst_list, nullptr, nullptr);
+    count_encode_list(output, dst_list);
+    return ret;
+}
+
+bool CauchyFecEncoderImpl::flush(encode_callback_t encode_callback, void * user_data)
+{
+    std::list<std::vector<uint8_t>> dst_list;
+    encode_output_t output(encode_callback, user_data, m_counters, false, dst_list);
+    return cm256_flush(m_cm256, m_option, m_group_id, m_buffers, m_repair_cache, m_aggregate, m_interleave, m_stats, dst_list, counted_callback(output), &output);
+}
+
+bool CauchyFecEncoderImpl::get_stats(encode_stats_t & encode_stats)
+{
+    encode_stats = m_stats;
+    return true;
+}
+
+bool CauchyFecEncoderImpl::get_counters(encode_counters_t & encode_counters) const
+{
+    encode_counters.input_frames = get_counter(m_counters.input_frames);
+    encode_counters.input_bytes = get_counter(m_counters.input_bytes);
+    encode_counters.output_packets = get_counter(m_counters.output_packets);
+    encode_counters.output_bytes = get_counter(m_counters.output_bytes);
+    encode_counters.repair_packets = get_counter(m_counters.repair_packets);
+    return true;
+}
+
+bool CauchyFecEncoderImpl::get_latency(encode_latency_t & encode_latency) const
+{
+    read_histogram(m_counters.encode_time, encode_latency.encode_time);
+    return true;
+}
+
+bool CauchyFecEncoderImpl::feedback(const receive_report_t & receive_report)
+{
+    update_loss_model(m_loss_model, receive_report);
+    return true;
+}
+
+bool CauchyFecEncoderImpl::repair(uint64_t group_id, uint32_t block_count, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    encode_output_t output(encode_callback, user_data, m_counters, true, dst_list);
+    const bool ret = cm256_repair(m_cm256, group_id, block_count, m_repair_cache, m_buffers, dst_list, counted_callback(output), &output);
+    count_encode_list(output, dst_list);
+    return ret;
+}
+
+bool CauchyFecEncoderImpl::repair_nack(const uint8_t * nack_data, uint32_t nack_size, std::list<std::vector<uint8_t>> & dst_list, encode_callback_t encode_callback, void * user_data)
+{
+    encode_output_t output(encode_callback, user_data, m_counters, true, dst_list);
+    const bool ret = cm256_repair_nack(m_cm256, nack_data, nack_size, m_repair_cache, m_buffers, dst_list, counted_callback(output), &output);
+    count_encode_list(output, dst_list);
+    return ret;
 }
 
 void CauchyFecEncoderImpl::reset()
 {
     m_group_id = 0;
+    m_repair_cache.reset();
+    m_aggregate.reset();
+    m_interleave.reset();
+    m_stats = encode_stats_t();
+    m_loss_model.reset();
+}
+
+/*
+ * decoder trace file, the calls of one decoder in order:
+ *     magic "cftr"(4) version(1) expire_millisecond(4) nack_millisecond(4) playout_millisecond(4) partial_frames(1), big endian,
+ *     version 2 adds max_buffered_groups(4) max_buffered_bytes(8)
+ *     then per call: varint microseconds since the previous call on the decoder clock, varint kind, kind - 2 bytes of data
+ *     kind 0 is decode() without data, kind 1 is reset(), a packet has kind size + 2
+ * the default decoder clock is the steady clock, an injected clock that steps back is recorded as 0, so a replay then runs ahead of what the decoder saw
+ */
+const uint8_t s_capture_magic[4] = { 'c', 'f', 't', 'r' };
+const uint8_t s_capture_version = 2;
+
+struct capture_t
+{
+    FILE *                                  file;
+    uint64_t                                last_time;
+    std::vector<uint8_t>                    record;
+
+    capture_t()
+        : file(nullptr)
+        , last_time(0)
+        , record()
+    {
+
+    }
+};
+
+static void close_capture(capture_t & capture)
+{
+    if (nullptr != capture.file)
+    {
+        fclose(capture.file);
+        capture.file = nullptr;
+    }
+}
+
+static void write_capture_uint32(std::vector<uint8_t> & data, uint32_t value)
+{
+    host_to_net(&value, sizeof(value));
+    data.insert(data.end(), reinterpret_cast<const uint8_t *>(&value), reinterpret_cast<const uint8_t *>(&value) + sizeof(value));
+}
+
+static bool open_capture(capture_t & capture, const char * file_path, const decode_option_t & option, uint64_t current_time)
+{
+    close_capture(capture);
+
+    if (nullptr == file_path || nullptr == (capture.file = fopen(file_path, "wb")))
+    {
+        return false;
+    }
+
+    capture.record.assign(s_capture_magic, s_capture_magic + sizeof(s_capture_magic));
+    capture.record.push_back(s_capture_version);
+    write_capture_uint32(capture.record, option.expire_millisecond);
+    write_capture_uint32(capture.record, option.nack_millisecond);
+    write_capture_uint32(capture.record, option.playout_millisecond);
+    capture.record.push_back(option.partial_frames ? 1 : 0);
+    write_capture_uint32(capture.record, option.max_buffered_groups);
+    write_capture_uint32(capture.record, static_cast<uint32_t>(option.max_buffered_bytes >> 32));
+    write_capture_uint32(capture.record, static_cast<uint32_t>(option.max_buffered_bytes));
+    capture.last_time = current_time;
+
+    if (capture.record.size() != fwrite(&capture.record[0], 1, capture.record.size(), capture.file))
+    {
+        close_capture(capture);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * a failed write ends the capture, the trace up to there stays readable
+ */
+static void capture_call(capture_t & capture, uint64_t current_time, uint64_t kind, const uint8_t * data, uint32_t size)
+{
+    if (nullptr == capture.file)
+    {
+        return;
+    }
+
+    /* an injected clock may step back, that is recorded as no time */
+    const uint64_t delta = (current_time > capture.last_time ? current_time - capture.last_time : 0);
+    capture.last_time = std::max<uint64_t>(current_time, capture.last_time);
+
+    capture.record.clear();
+    write_nack_varint(capture.record, delta);
+    write_nack_varint(capture.record, kind);
+    if (nullptr != data && 0 != size)
+    {
+        capture.record.insert(capture.record.end(), data, data + size);
+    }
+
+    if (capture.record.size() != fwrite(&capture.record[0], 1, capture.record.size(), capture.file))
+    {
+        close_capture(capture);
+    }
+}
+
+static void capture_decode(capture_t & capture, uint64_t current_time, const uint8_t * data, uint32_t size)
+{
+    capture_call(capture, current_time, (nullptr != data && 0 != size ? static_cast<uint64_t>(size) + 2 : 0), data, size);
+}
+
+/*
+ * one read per call, every timer of the call works with the same time
+ */
+static uint64_t read_decode_clock(const decode_option_t & option)
+{
+    return (nullptr != option.clock ? option.clock(option.clock_user_data) : get_steady_nanoseconds() / 1000);
 }
 
 class CauchyFecDecoderImpl
 {
 public:
-    CauchyFecDecoderImpl(uint32_t max_delay_microseconds = 1000 * 15);
+    CauchyFecDecoderImpl(const decode_option_t & option);
     CauchyFecDecoderImpl(const CauchyFecDecoderImpl &) = delete;
     CauchyFecDecoderImpl(CauchyFecDecoderImpl &&) = delete;
     CauchyFecDecoderImpl & operator = (const CauchyFecDecoderImpl &) = delete;
@@ -827,41 +3895,101 @@ public:
 public:
     bool decode(const uint8_t * src_data, uint32_t src_size, std::list<std::vector<uint8_t>> & dst_list);
     bool decode(const uint8_t * src_data, uint32_t src_size, decode_callback_t decode_callback, void * user_data);
+    bool decode(const uint8_t * src_data, uint32_t src_size, std::list<std::vector<uint8_t>> & dst_list, std::list<std::vector<frame_range_t>> & range_list);
+    bool decode(const uint8_t * src_data, uint32_t src_size, partial_decode_callback_t decode_callback, void * user_data);
 
 public:
     static bool recognizable(const uint8_t * src_data, uint32_t src_size);
 
+public:
+    bool get_report(receive_report_t & receive_report);
+    bool get_playout_stats(playout_stats_t & playout_stats);
+    bool get_counters(decode_counters_t & decode_counters) const;
+    bool get_latency(decode_latency_t & decode_latency) const;
+    bool nack(std::vector<uint8_t> & nack_data);
+
+public:
+    bool start_capture(const char * file_path);
+    void stop_capture();
+
 public:
     void reset();
 
 private:
-    const uint32_t      m_max_delay_microseconds;
+    bool decode(const uint8_t * src_data, uint32_t src_size, decode_output_t & output);
+
+private:
+    const decode_option_t           m_option;
+    const uint32_t                  m_max_delay_microseconds;
+    const uint32_t                  m_nack_delay_microseconds;
+    const uint32_t                  m_playout_delay_microseconds;
+    const bool                      m_partial_frames;
 
 private:
-    groups_t            m_groups;
+    CM256                           m_cm256;
+    groups_t                        m_groups;
+    playout_t                       m_playout;
+    capture_t                       m_capture;
 };
 
-CauchyFecDecoderImpl::CauchyFecDecoderImpl(uint32_t max_delay_microseconds)
-    : m_max_delay_microseconds(std::max<uint32_t>(max_delay_microseconds, 500))
+CauchyFecDecoderImpl::CauchyFecDecoderImpl(const decode_option_t & option)
+    : m_option(option)
+    , m_max_delay_microseconds(std::max<uint32_t>(option.expire_millisecond * 1000, 500))
+    , m_nack_delay_microseconds(option.nack_millisecond * 1000)
+    , m_playout_delay_microseconds(option.playout_millisecond * 1000)
+    , m_partial_frames(option.partial_frames)
+    , m_cm256()
     , m_groups()
+    , m_playout()
+    , m_capture()
 {
-
+    m_groups.max_buffered_groups = option.max_buffered_groups;
+    m_groups.max_buffered_bytes = option.max_buffered_bytes;
 }
 
 CauchyFecDecoderImpl::~CauchyFecDecoderImpl()
 {
-
+    close_capture(m_capture);
 }
 
 bool CauchyFecDecoderImpl::decode(const uint8_t * src_data, uint32_t src_size, std::list<std::vector<uint8_t>> & dst_list)
 {
-    return cm256_decode(src_data, src_size, m_groups, dst_list, m_max_delay_microseconds, nullptr, nullptr);
+    decode_output_t output(dst_list, nullptr, nullptr, nullptr, nullptr);
+    return decode(src_data, src_size, output);
 }
 
 bool CauchyFecDecoderImpl::decode(const uint8_t * src_data, uint32_t src_size, decode_callback_t decode_callback, void * user_data)
 {
     std::list<std::vector<uint8_t>> dst_list;
-    return cm256_decode(src_data, src_size, m_groups, dst_list, m_max_delay_microseconds, decode_callback, user_data);
+    decode_output_t output(dst_list, nullptr, decode_callback, nullptr, user_data);
+    return decode(src_data, src_size, output);
+}
+
+bool CauchyFecDecoderImpl::decode(const uint8_t * src_data, uint32_t src_size, std::list<std::vector<uint8_t>> & dst_list, std::list<std::vector<frame_range_t>> & range_list)
+{
+    decode_output_t output(dst_list, &range_list, nullptr, nullptr, nullptr);
+    return decode(src_data, src_size, output);
+}
+
+bool CauchyFecDecoderImpl::decode(const uint8_t * src_data, uint32_t src_size, partial_decode_callback_t decode_callback, void * user_data)
+{
+    std::list<std::vector<uint8_t>> dst_list;
+    decode_output_t output(dst_list, nullptr, nullptr, decode_callback, user_data);
+    return decode(src_data, src_size, output);
+}
+
+bool CauchyFecDecoderImpl::decode(const uint8_t * src_data, uint32_t src_size, decode_output_t & output)
+{
+    const uint64_t current_time = read_decode_clock(m_option);
+    capture_decode(m_capture, current_time, src_data, src_size);
+
+    output.counters = &m_groups.counters;
+    const bool ret = cm256_decode(m_cm256, src_data, src_size, m_groups, m_playout, current_time, m_max_delay_microseconds, m_nack_delay_microseconds, m_playout_delay_microseconds, m_partial_frames, output);
+
+    set_counter(m_groups.counters.buffered_groups, m_groups.decode_timer_list.size());
+    set_counter(m_groups.counters.buffered_bytes, m_groups.buffered_bytes);
+
+    return ret;
 }
 
 bool CauchyFecDecoderImpl::recognizable(const uint8_t * src_data, uint32_t src_size)
@@ -869,9 +3997,74 @@ bool CauchyFecDecoderImpl::recognizable(const uint8_t * src_data, uint32_t src_s
     return check_package(src_data, src_size);
 }
 
+bool CauchyFecDecoderImpl::get_report(receive_report_t & receive_report)
+{
+    receive_report = m_groups.report;
+    m_groups.report = receive_report_t();
+    return true;
+}
+
+bool CauchyFecDecoderImpl::get_playout_stats(playout_stats_t & playout_stats)
+{
+    make_playout_stats(m_playout, read_decode_clock(m_option), playout_stats);
+    return true;
+}
+
+bool CauchyFecDecoderImpl::get_counters(decode_counters_t & decode_counters) const
+{
+    const decode_counter_t & counters = m_groups.counters;
+    decode_counters.input_packets = get_counter(counters.input_packets);
+    decode_counters.input_bytes = get_counter(counters.input_bytes);
+    decode_counters.invalid_packets = get_counter(counters.invalid_packets);
+    decode_counters.duplicate_packets = get_counter(counters.duplicate_packets);
+    decode_counters.stale_packets = get_counter(counters.stale_packets);
+    decode_counters.complete_groups = get_counter(counters.complete_groups);
+    decode_counters.recovered_groups = get_counter(counters.recovered_groups);
+    decode_counters.expired_groups = get_counter(counters.expired_groups);
+    decode_counters.failed_groups = get_counter(counters.failed_groups);
+    decode_counters.recovered_blocks = get_counter(counters.recovered_blocks);
+    decode_counters.output_frames = get_counter(counters.output_frames);
+    decode_counters.output_bytes = get_counter(counters.output_bytes);
+    decode_counters.partial_frames = get_counter(counters.partial_frames);
+    decode_counters.dropped_frames = get_counter(counters.dropped_frames);
+    decode_counters.buffered_groups = get_counter(counters.buffered_groups);
+    decode_counters.buffered_bytes = get_counter(counters.buffered_bytes);
+    decode_counters.evicted_groups = get_counter(counters.evicted_groups);
+    decode_counters.evicted_frames = get_counter(counters.evicted_frames);
+    decode_counters.evicted_bytes = get_counter(counters.evicted_bytes);
+    return true;
+}
+
+bool CauchyFecDecoderImpl::get_latency(decode_latency_t & decode_latency) const
+{
+    read_histogram(m_groups.counters.group_latency, decode_latency.group_latency);
+    read_histogram(m_groups.counters.frame_latency, decode_latency.frame_latency);
+    read_histogram(m_groups.counters.decode_time, decode_latency.decode_time);
+    return true;
+}
+
+bool CauchyFecDecoderImpl::nack(std::vector<uint8_t> & nack_data)
+{
+    return cm256_nack(m_groups, read_decode_clock(m_option), m_nack_delay_microseconds, nack_data);
+}
+
+bool CauchyFecDecoderImpl::start_capture(const char * file_path)
+{
+    return open_capture(m_capture, file_path, m_option, read_decode_clock(m_option));
+}
+
+void CauchyFecDecoderImpl::stop_capture()
+{
+    close_capture(m_capture);
+}
+
 void CauchyFecDecoderImpl::reset()
 {
+    capture_call(m_capture, read_decode_clock(m_option), 1, nullptr, 0);
     m_groups.reset();
+    m_playout.reset();
+    set_counter(m_groups.counters.buffered_groups, 0);
+    set_counter(m_groups.counters.buffered_bytes, 0);
 }
 
 CauchyFecEncoder::CauchyFecEncoder()
@@ -886,10 +4079,39 @@ CauchyFecEncoder::~CauchyFecEncoder()
 }
 
 bool CauchyFecEncoder::init(uint32_t max_block_size, double recovery_rate, bool force_recovery)
+{
+    encode_option_t option;
+    option.max_block_size = max_block_size;
+    option.recovery_rate = recovery_rate;
+    option.force_recovery = force_recovery;
+    return init(option);
+}
+
+bool CauchyFecEncoder::init(const encode_option_t & option)
 {
     exit();
 
-    return nullptr != (m_encoder = new CauchyFecEncoderImpl(max_block_size, recovery_rate, force_recovery));
+    if ((1 != option.header_version && 2 != option.header_version) || (16 != option.group_id_bits && 24 != option.group_id_bits))
+    {
+        return false;
+    }
+
+    if (0 != option.aggregate_bytes && 2 != option.header_version)
+    {
+        return false;
+    }
+
+    if (option.send_timestamp && 2 != option.header_version)
+    {
+        return false;
+    }
+
+    if (option.adaptive_recovery && (option.target_loss_rate <= 0.0 || option.target_loss_rate >= 1.0 || option.max_recovery_rate <= 0.0 || option.max_recovery_rate >= 1.0))
+    {
+        return false;
+    }
+
+    return nullptr != (m_encoder = new CauchyFecEncoderImpl(option));
 }
 
 void CauchyFecEncoder::exit()
@@ -911,6 +4133,69 @@ bool CauchyFecEncoder::encode(const uint8_t * src_data, uint32_t src_size, encod
     return nullptr != m_encoder && m_encoder->encode(src_data, src_size, encode_callback, user_data);
 }
 
+bool CauchyFecEncoder::encode(const uint8_t * src_data, uint32_t src_size, const frame_option_t & frame_option, std::list<std::vector<uint8_t>> & dst_list)
+{
+    return nullptr != m_encoder && m_encoder->encode(src_data, src_size, frame_option, dst_list, nullptr, nullptr);
+}
+
+bool CauchyFecEncoder::encode(const uint8_t * src_data, uint32_t src_size, const frame_option_t & frame_option, encode_callback_t encode_callback, void * user_data)
+{
+    std::list<std::vector<uint8_t>> dst_list;
+    return nullptr != m_encoder && m_encoder->encode(src_data, src_size, frame_option, dst_list, encode_callback, user_data);
+}
+
+bool CauchyFecEncoder::flush(std::list<std::vector<uint8_t>> & dst_list)
+{
+    return nullptr != m_encoder && m_encoder->flush(dst_list);
+}
+
+bool CauchyFecEncoder::flush(encode_callback_t encode_callback, void * user_data)
+{
+    return nullptr != m_encoder && m_encoder->flush(encode_callback, user_data);
+}
+
+bool CauchyFecEncoder::get_stats(encode_stats_t & encode_stats)
+{
+    return nullptr != m_encoder && m_encoder->get_stats(encode_stats);
+}
+
+bool CauchyFecEncoder::get_counters(encode_counters_t & encode_counters)
+{
+    return nullptr != m_encoder && m_encoder->get_counters(encode_counters);
+}
+
+bool CauchyFecEncoder::get_latency(encode_latency_t & encode_latency)
+{
+    return nullptr != m_encoder && m_encoder->get_latency(encode_latency);
+}
+
+bool CauchyFecEncoder::feedback(const receive_report_t & receive_report)
+{
+    return nullptr != m_encoder && m_encoder->feedback(receive_report);
+}
+
+bool CauchyFecEncoder::repair(uint64_t group_id, uint32_t block_count, std::list<std::vector<uint8_t>> & dst_list)
+{
+    return nullptr != m_encoder && m_encoder->repair(group_id, block_count, dst_list, nullptr, nullptr);
+}
+
+bool CauchyFecEncoder::repair(uint64_t group_id, uint32_t block_count, encode_callback_t encode_callback, void * user_data)
+{
+    std::list<std::vector<uint8_t>> dst_list;
+    return nullptr != m_encoder && m_encoder->repair(group_id, block_count, dst_list, encode_callback, user_data);
+}
+
+bool CauchyFecEncoder::repair_nack(const uint8_t * nack_data, uint32_t nack_size, std::list<std::vector<uint8_t>> & dst_list)
+{
+    return nullptr != m_encoder && m_encoder->repair_nack(nack_data, nack_size, dst_list, nullptr, nullptr);
+}
+
+bool CauchyFecEncoder::repair_nack(const uint8_t * nack_data, uint32_t nack_size, encode_callback_t encode_callback, void * user_data)
+{
+    std::list<std::vector<uint8_t>> dst_list;
+    return nullptr != m_encoder && m_encoder->repair_nack(nack_data, nack_size, dst_list, encode_callback, user_data);
+}
+
 void CauchyFecEncoder::reset()
 {
     if (nullptr != m_encoder)
@@ -930,11 +4215,19 @@ CauchyFecDecoder::~CauchyFecDecoder()
     exit();
 }
 
-bool CauchyFecDecoder::init(uint32_t expire_millisecond)
+bool CauchyFecDecoder::init(uint32_t expire_millisecond, uint32_t nack_millisecond)
+{
+    decode_option_t option;
+    option.expire_millisecond = expire_millisecond;
+    option.nack_millisecond = nack_millisecond;
+    return init(option);
+}
+
+bool CauchyFecDecoder::init(const decode_option_t & option)
 {
     exit();
 
-    return nullptr != (m_decoder = new CauchyFecDecoderImpl(expire_millisecond * 1000));
+    return nullptr != (m_decoder = new CauchyFecDecoderImpl(option));
 }
 
 void CauchyFecDecoder::exit()
@@ -956,11 +4249,59 @@ bool CauchyFecDecoder::decode(const uint8_t * src_data, uint32_t src_size, decod
     return nullptr != m_decoder && m_decoder->decode(src_data, src_size, decode_callback, user_data);
 }
 
+bool CauchyFecDecoder::decode(const uint8_t * src_data, uint32_t src_size, std::list<std::vector<uint8_t>> & dst_list, std::list<std::vector<frame_range_t>> & range_list)
+{
+    return nullptr != m_decoder && m_decoder->decode(src_data, src_size, dst_list, range_list);
+}
+
+bool CauchyFecDecoder::decode(const uint8_t * src_data, uint32_t src_size, partial_decode_callback_t decode_callback, void * user_data)
+{
+    return nullptr != m_decoder && m_decoder->decode(src_data, src_size, decode_callback, user_data);
+}
+
 bool CauchyFecDecoder::recognizable(const uint8_t * src_data, uint32_t src_size)
 {
     return CauchyFecDecoderImpl::recognizable(src_data, src_size);
 }
 
+bool CauchyFecDecoder::get_report(receive_report_t & receive_report)
+{
+    return nullptr != m_decoder && m_decoder->get_report(receive_report);
+}
+
+bool CauchyFecDecoder::get_playout_stats(playout_stats_t & playout_stats)
+{
+    return nullptr != m_decoder && m_decoder->get_playout_stats(playout_stats);
+}
+
+bool CauchyFecDecoder::get_counters(decode_counters_t & decode_counters)
+{
+    return nullptr != m_decoder && m_decoder->get_counters(decode_counters);
+}
+
+bool CauchyFecDecoder::get_latency(decode_latency_t & decode_latency)
+{
+    return nullptr != m_decoder && m_decoder->get_latency(decode_latency);
+}
+
+bool CauchyFecDecoder::nack(std::vector<uint8_t> & nack_data)
+{
+    return nullptr != m_decoder && m_decoder->nack(nack_data);
+}
+
+bool CauchyFecDecoder::start_capture(const char * file_path)
+{
+    return nullptr != m_decoder && m_decoder->start_capture(file_path);
+}
+
+void CauchyFecDecoder::stop_capture()
+{
+    if (nullptr != m_decoder)
+    {
+        m_decoder->stop_capture();
+    }
+}
+
 void CauchyFecDecoder::reset()
 {
     if (nullptr != m_decoder)
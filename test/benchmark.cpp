@@ -0,0 +1,357 @@
+/********************************************************
+ * Description : cauchy fec benchmark
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2025
+ ********************************************************/
+
+#include <ctime>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include "cauchy_fec.h"
+#include "test_tool.h"
+
+typedef std::chrono::steady_clock bench_clock_t;
+
+static double elapsed_microseconds(const bench_clock_t::time_point & begin, const bench_clock_t::time_point & end)
+{
+    return std::chrono::duration<double, std::micro>(end - begin).count();
+}
+
+/*
+ * one row of the group size curve:
+ *   encode/decode throughput of whole frames, every 11th packet lost so that most groups need recovery,
+ *   and the latency side, the packets a receiver needs before the first group can be decoded,
+ *   the time it takes on the wire at 100 Mbit/s and the decode time of one group
+ */
+static bool bench_group_size(uint8_t max_original_count, const std::vector<uint8_t> & src_data, uint32_t rounds)
+{
+    encode_option_t option;
+    option.max_original_count = max_original_count;
+
+    CauchyFecEncoder encoder;
+    if (!encoder.init(option))
+    {
+        return false;
+    }
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(1000))
+    {
+        return false;
+    }
+
+    double encode_microseconds = 0.0;
+    double decode_microseconds = 0.0;
+    uint32_t delivered = 0;
+    encode_stats_t encode_stats;
+
+    for (uint32_t round = 0; round < rounds; ++round)
+    {
+        std::list<std::vector<uint8_t>> tmp_list;
+
+        const bench_clock_t::time_point encode_begin = bench_clock_t::now();
+        if (!encoder.encode(&src_data[0], static_cast<uint32_t>(src_data.size()), tmp_list))
+        {
+            return false;
+        }
+        const bench_clock_t::time_point encode_end = bench_clock_t::now();
+        encode_microseconds += elapsed_microseconds(encode_begin, encode_end);
+
+        encoder.get_stats(encode_stats);
+
+        std::list<std::vector<uint8_t>> dst_list;
+
+        uint32_t index = 0;
+        const bench_clock_t::time_point decode_begin = bench_clock_t::now();
+        for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+        {
+            if (0 == ++index % 11)
+            {
+                continue;
+            }
+            const std::vector<uint8_t> & data = *iter;
+            decoder.decode(&data[0], static_cast<uint32_t>(data.size()), dst_list);
+        }
+        const bench_clock_t::time_point decode_end = bench_clock_t::now();
+        decode_microseconds += elapsed_microseconds(decode_begin, decode_end);
+
+        if (1 == dst_list.size() && dst_list.front() == src_data)
+        {
+            ++delivered;
+        }
+    }
+
+    const double megabytes = static_cast<double>(src_data.size()) * rounds / (1024.0 * 1024.0);
+    const uint32_t group_originals = (encode_stats.original_count + encode_stats.group_count - 1) / encode_stats.group_count;
+    const double first_group_microseconds = static_cast<double>(group_originals) * encode_stats.block_size * 8.0 / 100.0;
+
+    printf("%8u %8u %8u %8u %12.1f %12.1f %12.1f %16.1f %10u/%u\n",
+        static_cast<uint32_t>(max_original_count), encode_stats.group_count, encode_stats.original_count, encode_stats.recovery_count,
+        megabytes / (encode_microseconds / 1000000.0), megabytes / (decode_microseconds / 1000000.0),
+        decode_microseconds / rounds / encode_stats.group_count, first_group_microseconds, delivered, rounds);
+
+    return true;
+}
+
+/*
+ * loss of the suite, reproducible across runs and releases: xorshift32 with a fixed seed,
+ * random drops every packet with loss_rate, burst drops runs of burst_size packets started so that the average loss is loss_rate
+ */
+struct bench_loss_t
+{
+    tool_random_t           random;
+    double                  loss_rate;
+    uint32_t                burst_size;
+    uint32_t                burst_remain;
+
+    bench_loss_t(double rate, uint32_t size)
+        : random(0x9e3779b9)
+        , loss_rate(rate)
+        , burst_size(std::max<uint32_t>(size, 1))
+        , burst_remain(0)
+    {
+
+    }
+
+    bool drop()
+    {
+        if (0 != burst_remain)
+        {
+            --burst_remain;
+            return true;
+        }
+        if (random.uniform() < loss_rate / burst_size)
+        {
+            burst_remain = burst_size - 1;
+            return true;
+        }
+        return false;
+    }
+};
+
+struct bench_case_t
+{
+    const char *            sweep;
+    uint32_t                block_size;
+    uint8_t                 max_original_count;
+    double                  recovery_rate;
+    double                  loss_rate;
+    uint32_t                burst_size;
+
+    bench_case_t(const char * case_sweep, uint32_t case_block_size, uint8_t case_max_original_count, double case_recovery_rate, double case_loss_rate, uint32_t case_burst_size)
+        : sweep(case_sweep)
+        , block_size(case_block_size)
+        , max_original_count(case_max_original_count)
+        , recovery_rate(case_recovery_rate)
+        , loss_rate(case_loss_rate)
+        , burst_size(case_burst_size)
+    {
+
+    }
+};
+
+/*
+ * one case of the suite: every round encodes the frame, drops packets by the loss pattern and decodes the rest,
+ * encode() is timed per frame and decode() per packet, the decoder is reset between rounds so that an unrecoverable group does not hold back the next round
+ */
+static bool bench_case(const bench_case_t & bench, const std::vector<uint8_t> & src_data, uint32_t rounds, bool first)
+{
+    encode_option_t option;
+    option.max_block_size = bench.block_size;
+    option.max_original_count = bench.max_original_count;
+    option.recovery_rate = bench.recovery_rate;
+
+    CauchyFecEncoder encoder;
+    if (!encoder.init(option))
+    {
+        return false;
+    }
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(1000))
+    {
+        return false;
+    }
+
+    bench_loss_t loss(bench.loss_rate, bench.burst_size);
+    std::vector<double> encode_samples;
+    std::vector<double> decode_samples;
+    double encode_microseconds = 0.0;
+    double decode_microseconds = 0.0;
+    uint64_t encode_packets = 0;
+    uint64_t decode_packets = 0;
+    uint32_t delivered = 0;
+    encode_stats_t encode_stats;
+
+    for (uint32_t round = 0; round < rounds; ++round)
+    {
+        std::list<std::vector<uint8_t>> tmp_list;
+
+        const bench_clock_t::time_point encode_begin = bench_clock_t::now();
+        if (!encoder.encode(&src_data[0], static_cast<uint32_t>(src_data.size()), tmp_list))
+        {
+            return false;
+        }
+        const bench_clock_t::time_point encode_end = bench_clock_t::now();
+        encode_samples.push_back(elapsed_microseconds(encode_begin, encode_end));
+        encode_microseconds += encode_samples.back();
+        encode_packets += tmp_list.size();
+
+        encoder.get_stats(encode_stats);
+
+        std::list<std::vector<uint8_t>> dst_list;
+        for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+        {
+            if (loss.drop())
+            {
+                continue;
+            }
+            const std::vector<uint8_t> & data = *iter;
+            const bench_clock_t::time_point decode_begin = bench_clock_t::now();
+            decoder.decode(&data[0], static_cast<uint32_t>(data.size()), dst_list);
+            const bench_clock_t::time_point decode_end = bench_clock_t::now();
+            decode_samples.push_back(elapsed_microseconds(decode_begin, decode_end) * 1000.0);
+            decode_microseconds += decode_samples.back() / 1000.0;
+            ++decode_packets;
+        }
+
+        if (1 == dst_list.size() && dst_list.front() == src_data)
+        {
+            ++delivered;
+        }
+
+        decoder.reset();
+    }
+
+    const double megabytes = static_cast<double>(src_data.size()) * rounds / (1024.0 * 1024.0);
+
+    tool_json_t json((first ? "    " : ",\n    "), "     ");
+    json.text("sweep", bench.sweep);
+    json.number("block_size", bench.block_size);
+    json.number("max_original_count", bench.max_original_count);
+    json.real("recovery_rate", bench.recovery_rate, 3);
+    json.real("loss_rate", bench.loss_rate, 3);
+    json.text("loss_pattern", (bench.burst_size > 1 ? "burst" : "random"));
+    json.number("burst_size", bench.burst_size);
+    json.wrap();
+    json.number("groups", encode_stats.group_count);
+    json.number("original_blocks", encode_stats.original_count);
+    json.number("recovery_blocks", encode_stats.recovery_count);
+    json.number("frames", rounds);
+    json.number("delivered", delivered);
+    json.wrap();
+    json.real("encode_mb_s", megabytes / (encode_microseconds / 1000000.0), 1);
+    json.real("encode_packets_s", encode_packets / (encode_microseconds / 1000000.0), 0);
+    json.real("encode_ns_packet", encode_microseconds * 1000.0 / encode_packets, 1);
+    json.real("encode_p50_us", tool_percentile(encode_samples, 0.5), 1);
+    json.real("encode_p99_us", tool_percentile(encode_samples, 0.99), 1);
+    json.wrap();
+    json.real("decode_mb_s", megabytes / (decode_microseconds / 1000000.0), 1);
+    json.real("decode_packets_s", decode_packets / (decode_microseconds / 1000000.0), 0);
+    json.real("decode_ns_packet", decode_microseconds * 1000.0 / std::max<uint64_t>(decode_packets, 1), 1);
+    json.real("decode_p50_ns", tool_percentile(decode_samples, 0.5), 1);
+    json.real("decode_p99_ns", tool_percentile(decode_samples, 0.99), 1);
+    json.close("");
+
+    return true;
+}
+
+/*
+ * the suite sweeps one parameter at a time around a baseline of 1100 byte packets, up to 255 originals per group,
+ * recovery rate 0.1 and 5% random loss, and writes one JSON document to stdout to compare releases
+ */
+static int bench_suite(const std::vector<uint8_t> & src_data, uint32_t rounds)
+{
+    std::vector<bench_case_t> bench_cases;
+
+    const uint32_t block_sizes[] = { 64, 256, 1100, 4096, 16384, 65536 };
+    for (uint32_t index = 0; index < sizeof(block_sizes) / sizeof(block_sizes[0]); ++index)
+    {
+        bench_cases.push_back(bench_case_t("block_size", block_sizes[index], 255, 0.1, 0.05, 1));
+    }
+
+    const uint8_t original_counts[] = { 4, 16, 64, 128, 255 };
+    for (uint32_t index = 0; index < sizeof(original_counts) / sizeof(original_counts[0]); ++index)
+    {
+        bench_cases.push_back(bench_case_t("max_original_count", 1100, original_counts[index], 0.1, 0.05, 1));
+    }
+
+    const double recovery_rates[] = { 0.02, 0.05, 0.1, 0.2, 0.33, 0.5 };
+    for (uint32_t index = 0; index < sizeof(recovery_rates) / sizeof(recovery_rates[0]); ++index)
+    {
+        bench_cases.push_back(bench_case_t("recovery_rate", 1100, 255, recovery_rates[index], 0.05, 1));
+    }
+
+    const double loss_rates[] = { 0.0, 0.01, 0.05, 0.09, 0.15 };
+    for (uint32_t index = 0; index < sizeof(loss_rates) / sizeof(loss_rates[0]); ++index)
+    {
+        bench_cases.push_back(bench_case_t("loss_rate", 1100, 255, 0.1, loss_rates[index], 1));
+    }
+
+    const uint32_t burst_sizes[] = { 1, 2, 4, 16 };
+    for (uint32_t index = 0; index < sizeof(burst_sizes) / sizeof(burst_sizes[0]); ++index)
+    {
+        bench_cases.push_back(bench_case_t("loss_pattern", 1100, 255, 0.1, 0.05, burst_sizes[index]));
+    }
+
+    printf("{\"frame_size\": %u, \"rounds\": %u, \"results\": [\n", static_cast<uint32_t>(src_data.size()), rounds);
+    for (std::size_t index = 0; index < bench_cases.size(); ++index)
+    {
+        if (!bench_case(bench_cases[index], src_data, rounds, 0 == index))
+        {
+            printf("\n]}\n");
+            return 2;
+        }
+    }
+    printf("\n]}\n");
+
+    return 0;
+}
+
+int main(int argc, char * argv[])
+{
+    const bool json = (argc > 1 && 0 == strcmp(argv[1], "--json"));
+    const int arg_base = (json ? 2 : 1);
+    const uint32_t frame_size = (argc > arg_base ? static_cast<uint32_t>(atoi(argv[arg_base])) : 307608);
+    const uint32_t rounds = (argc > arg_base + 1 ? static_cast<uint32_t>(atoi(argv[arg_base + 1])) : (json ? 20 : 50));
+
+    if (0 == frame_size || 0 == rounds)
+    {
+        std::cout << "usage: " << argv[0] << " [--json] [frame_size] [rounds]" << std::endl;
+        return 1;
+    }
+
+    std::vector<uint8_t> src_data(frame_size, 0x0);
+
+    srand(static_cast<uint32_t>(time(nullptr)));
+    for (std::vector<uint8_t>::iterator iter = src_data.begin(); src_data.end() != iter; ++iter)
+    {
+        *iter = static_cast<uint8_t>(rand());
+    }
+
+    if (json)
+    {
+        return bench_suite(src_data, rounds);
+    }
+
+    std::cout << "frame " << frame_size << " bytes, " << rounds << " rounds, recovery rate 0.1, every 11th packet lost" << std::endl;
+    printf("%8s %8s %8s %8s %12s %12s %12s %16s %12s\n", "k max", "groups", "k", "m", "enc MB/s", "dec MB/s", "us/group", "1st group us", "delivered");
+
+    const uint8_t group_sizes[] = { 4, 8, 16, 32, 64, 128, 255 };
+    for (uint32_t index = 0; index < sizeof(group_sizes) / sizeof(group_sizes[0]); ++index)
+    {
+        if (!bench_group_size(group_sizes[index], src_data, rounds))
+        {
+            return 2;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,206 @@
+/********************************************************
+ * Description : gf256 kernel benchmark
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2025
+ ********************************************************/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "gf256.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif // _MSC_VER
+    #define KERNEL_BENCH_UNIT "cycles"
+#else
+    #define KERNEL_BENCH_UNIT "ns"
+#endif
+
+#if defined(USE_SSSE3)
+    #define KERNEL_BENCH_ISA "ssse3"
+#elif defined(USE_NEON)
+    #define KERNEL_BENCH_ISA "neon"
+#else
+    #define KERNEL_BENCH_ISA "scalar"
+#endif
+
+/*
+ * time stamp counter where there is one, the steady clock in nanoseconds elsewhere
+ */
+static uint64_t read_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+static gf256_ctx s_gf256_ctx;
+
+enum kernel_t
+{
+    kernel_add_mem,
+    kernel_add2_mem,
+    kernel_addset_mem,
+    kernel_mul_mem,
+    kernel_muladd_mem,
+    kernel_count
+};
+
+static const char * const s_kernel_names[kernel_count] = { "gf256_add_mem", "gf256_add2_mem", "gf256_addset_mem", "gf256_mul_mem", "gf256_muladd_mem" };
+
+static void run_kernel(kernel_t kernel, uint8_t * z, const uint8_t * x, const uint8_t * y, int bytes)
+{
+    switch (kernel)
+    {
+        case kernel_add_mem:
+            gf256_ctx::gf256_add_mem(z, x, bytes);
+            break;
+        case kernel_add2_mem:
+            gf256_ctx::gf256_add2_mem(z, x, y, bytes);
+            break;
+        case kernel_addset_mem:
+            gf256_ctx::gf256_addset_mem(z, x, y, bytes);
+            break;
+        case kernel_mul_mem:
+            s_gf256_ctx.gf256_mul_mem(z, x, 0x53, bytes);
+            break;
+        case kernel_muladd_mem:
+            s_gf256_ctx.gf256_muladd_mem(z, 0x53, x, bytes);
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * cycles per byte of one kernel, one size and one misalignment of all its buffers against 16 bytes:
+ * calls are batched to about 1 MB per trial so that the counter read does not dominate small sizes, the best of the trials counts
+ */
+static double bench_kernel(kernel_t kernel, uint32_t size, uint32_t misalignment, uint8_t * z, const uint8_t * x, const uint8_t * y, uint32_t trials)
+{
+    const uint32_t calls = std::max<uint32_t>((1 << 20) / size, 1);
+
+    double best = 0.0;
+    for (uint32_t trial = 0; trial < trials; ++trial)
+    {
+        const uint64_t begin = read_cycles();
+        for (uint32_t call = 0; call < calls; ++call)
+        {
+            run_kernel(kernel, z + misalignment, x + misalignment, y + misalignment, static_cast<int>(size));
+        }
+        const uint64_t end = read_cycles();
+
+        const double per_byte = static_cast<double>(end - begin) / (static_cast<double>(calls) * size);
+        if (0 == trial || per_byte < best)
+        {
+            best = per_byte;
+        }
+    }
+
+    return best;
+}
+
+int main(int argc, char * argv[])
+{
+    const bool json = (argc > 1 && 0 == strcmp(argv[1], "--json"));
+    const uint32_t trials = (argc > (json ? 2 : 1) ? static_cast<uint32_t>(atoi(argv[json ? 2 : 1])) : 3);
+
+    if (0 == trials || !s_gf256_ctx.isInitialized())
+    {
+        printf("usage: %s [--json] [trials]\n", argv[0]);
+        return 1;
+    }
+
+    /* powers of two from 1 B to 1 MB, and 15 bytes more from 16 B on so that the 8, 4 and 1 byte tails run too */
+    std::vector<uint32_t> sizes;
+    for (uint32_t size = 1; size <= (1 << 20); size <<= 1)
+    {
+        sizes.push_back(size);
+        if (size >= 16)
+        {
+            sizes.push_back(size + 15);
+        }
+    }
+
+    const uint32_t buffer_size = (1 << 20) + 64;
+    std::vector<uint8_t> storage(buffer_size * 3 + 16, 0x0);
+    for (std::vector<uint8_t>::iterator iter = storage.begin(); storage.end() != iter; ++iter)
+    {
+        *iter = static_cast<uint8_t>(rand());
+    }
+
+    const uintptr_t base = reinterpret_cast<uintptr_t>(&storage[0]);
+    uint8_t * z = &storage[0] + (16 - base % 16) % 16;
+    uint8_t * x = z + buffer_size;
+    uint8_t * y = x + buffer_size;
+
+    if (json)
+    {
+        printf("{\"isa\": \"%s\", \"unit\": \"%s/byte\", \"trials\": %u, \"results\": [\n", KERNEL_BENCH_ISA, KERNEL_BENCH_UNIT, trials);
+    }
+
+    bool first = true;
+    for (uint32_t kernel = 0; kernel < kernel_count; ++kernel)
+    {
+        if (!json)
+        {
+            printf("%s (%s), %s/byte by misalignment\n%8s", s_kernel_names[kernel], KERNEL_BENCH_ISA, KERNEL_BENCH_UNIT, "bytes");
+            for (uint32_t misalignment = 0; misalignment < 16; ++misalignment)
+            {
+                printf(" %6u", misalignment);
+            }
+            printf("\n");
+        }
+
+        for (std::vector<uint32_t>::const_iterator iter = sizes.begin(); sizes.end() != iter; ++iter)
+        {
+            if (!json)
+            {
+                printf("%8u", *iter);
+            }
+
+            for (uint32_t misalignment = 0; misalignment < 16; ++misalignment)
+            {
+                const double per_byte = bench_kernel(static_cast<kernel_t>(kernel), *iter, misalignment, z, x, y, trials);
+                if (json)
+                {
+                    printf("%s  {\"kernel\": \"%s\", \"isa\": \"%s\", \"bytes\": %u, \"misalignment\": %u, \"per_byte\": %.4f}", (first ? "" : ",\n"), s_kernel_names[kernel], KERNEL_BENCH_ISA, *iter, misalignment, per_byte);
+                    first = false;
+                }
+                else
+                {
+                    printf(" %6.3f", per_byte);
+                }
+            }
+
+            if (!json)
+            {
+                printf("\n");
+            }
+        }
+
+        if (!json)
+        {
+            printf("\n");
+        }
+    }
+
+    if (json)
+    {
+        printf("\n]}\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,199 @@
+/********************************************************
+ * Description : cauchy fec decoder trace replay
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2025
+ ********************************************************/
+
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "cauchy_fec.h"
+#include "test_tool.h"
+
+typedef std::chrono::steady_clock replay_clock_t;
+
+/*
+ * trace file of CauchyFecDecoder::start_capture():
+ *     magic "cftr"(4) version(1) expire_millisecond(4) nack_millisecond(4) playout_millisecond(4) partial_frames(1), big endian,
+ *     version 2 adds max_buffered_groups(4) max_buffered_bytes(8)
+ *     then per call: varint microseconds since the previous call, varint kind (0: decode() without data, 1: reset(), else a packet of kind - 2 bytes), data
+ */
+static bool read_varint(FILE * file, uint64_t & value)
+{
+    value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7)
+    {
+        const int byte = fgetc(file);
+        if (EOF == byte)
+        {
+            return false;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (0 == (byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t read_uint32(const uint8_t * data)
+{
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+struct replay_result_t
+{
+    uint64_t                calls;
+    uint64_t                packets;
+    uint64_t                packet_bytes;
+    uint64_t                frames;
+    uint64_t                frame_bytes;
+    double                  decode_nanoseconds;
+    std::vector<double>     call_nanoseconds;
+
+    replay_result_t()
+        : calls(0)
+        , packets(0)
+        , packet_bytes(0)
+        , frames(0)
+        , frame_bytes(0)
+        , decode_nanoseconds(0.0)
+        , call_nanoseconds()
+    {
+
+    }
+};
+
+static void replay_frame_callback(void * user_data, const uint8_t * dst_data, uint32_t dst_size, const frame_range_t * valid_ranges, uint32_t valid_range_count)
+{
+    replay_result_t & result = *reinterpret_cast<replay_result_t *>(user_data);
+    result.frames += 1;
+    result.frame_bytes += dst_size;
+}
+
+static uint64_t replay_decode_clock(void * user_data)
+{
+    return *reinterpret_cast<const uint64_t *>(user_data);
+}
+
+int main(int argc, char * argv[])
+{
+    const bool realtime = (argc > 2 && 0 == strcmp(argv[2], "realtime"));
+    if (argc < 2 || (argc > 2 && !realtime && 0 != strcmp(argv[2], "fast")))
+    {
+        printf("usage: %s trace_file [fast|realtime]\n", argv[0]);
+        return 1;
+    }
+
+    FILE * file = fopen(argv[1], "rb");
+    if (nullptr == file)
+    {
+        printf("can not open %s\n", argv[1]);
+        return 2;
+    }
+
+    uint8_t head[30] = { 0x0 };
+    if (18 != fread(head, 1, 18, file) || 0 != memcmp(head, "cftr", 4) || (1 != head[4] && 2 != head[4]) || (2 == head[4] && 12 != fread(head + 18, 1, 12, file)))
+    {
+        printf("%s is no decoder trace\n", argv[1]);
+        fclose(file);
+        return 3;
+    }
+
+    decode_option_t option;
+    option.expire_millisecond = read_uint32(head + 5);
+    option.nack_millisecond = read_uint32(head + 9);
+    option.playout_millisecond = read_uint32(head + 13);
+    option.partial_frames = (0 != head[17]);
+    if (2 == head[4])
+    {
+        option.max_buffered_groups = read_uint32(head + 18);
+        option.max_buffered_bytes = (static_cast<uint64_t>(read_uint32(head + 22)) << 32) | read_uint32(head + 26);
+    }
+
+    /* the decoder runs on the trace time, so fast replays expire and release exactly like the capture did */
+    uint64_t trace_microseconds = 0;
+    option.clock = replay_decode_clock;
+    option.clock_user_data = &trace_microseconds;
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(option))
+    {
+        fclose(file);
+        return 4;
+    }
+
+    /* realtime keeps the captured gaps between calls, fast feeds the calls back to back */
+    replay_result_t result;
+    std::vector<uint8_t> data;
+    const replay_clock_t::time_point start = replay_clock_t::now();
+
+    uint64_t delta = 0;
+    uint64_t kind = 0;
+    while (read_varint(file, delta) && read_varint(file, kind))
+    {
+        trace_microseconds += delta;
+
+        data.resize(kind > 2 ? static_cast<std::size_t>(kind - 2) : 0);
+        if (!data.empty() && data.size() != fread(&data[0], 1, data.size(), file))
+        {
+            break;
+        }
+
+        if (realtime)
+        {
+            std::this_thread::sleep_until(start + std::chrono::microseconds(trace_microseconds));
+        }
+
+        result.calls += 1;
+        if (1 == kind)
+        {
+            decoder.reset();
+            continue;
+        }
+
+        const replay_clock_t::time_point begin = replay_clock_t::now();
+        decoder.decode((data.empty() ? nullptr : &data[0]), static_cast<uint32_t>(data.size()), replay_frame_callback, &result);
+        const double nanoseconds = std::chrono::duration<double, std::nano>(replay_clock_t::now() - begin).count();
+
+        result.decode_nanoseconds += nanoseconds;
+        result.call_nanoseconds.push_back(nanoseconds);
+        if (!data.empty())
+        {
+            result.packets += 1;
+            result.packet_bytes += data.size();
+        }
+    }
+
+    fclose(file);
+
+    const double wall_seconds = std::chrono::duration<double>(replay_clock_t::now() - start).count();
+
+    tool_json_t json("", " ");
+    json.text("trace", argv[1]);
+    json.text("mode", (realtime ? "realtime" : "fast"));
+    json.real("trace_seconds", trace_microseconds / 1000000.0, 3);
+    json.real("wall_seconds", wall_seconds, 3);
+    json.number("calls", result.calls);
+    json.number("packets", result.packets);
+    json.number("packet_bytes", result.packet_bytes);
+    json.number("frames", result.frames);
+    json.number("frame_bytes", result.frame_bytes);
+    json.wrap();
+    json.real("decode_ns_packet", result.decode_nanoseconds / std::max<uint64_t>(result.packets, 1), 1);
+    json.real("decode_ns_byte", result.decode_nanoseconds / std::max<uint64_t>(result.packet_bytes, 1), 3);
+    json.real("call_p50_ns", tool_percentile(result.call_nanoseconds, 0.5), 1);
+    json.real("call_p99_ns", tool_percentile(result.call_nanoseconds, 0.99), 1);
+    json.real("call_max_ns", tool_percentile(result.call_nanoseconds, 1.0), 1);
+    json.close("\n");
+
+    return 0;
+}
@@ -0,0 +1,408 @@
+/********************************************************
+ * Description : cauchy fec network loss simulator
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2025
+ ********************************************************/
+
+#include <map>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "cauchy_fec.h"
+#include "test_tool.h"
+
+typedef std::chrono::steady_clock sim_clock_t;
+
+/*
+ * all parameters are given as key=value on the command line, times are milliseconds
+ */
+struct sim_option_t
+{
+    uint32_t                frames;                 // frames sent
+    uint32_t                fps;                    // frames per second
+    uint32_t                frame_size;             // bytes per frame
+    uint32_t                pace_millisecond;       // the packets of a frame are spread evenly over this time, 0: sent at once
+    uint32_t                block_size;             // encode_option_t::max_block_size
+    double                  recovery_rate;          // encode_option_t::recovery_rate
+    uint32_t                max_original_count;     // encode_option_t::max_original_count
+    uint32_t                header_version;         // encode_option_t::header_version
+    uint32_t                expire_millisecond;     // decode_option_t::expire_millisecond
+    double                  loss;                   // bernoulli loss rate, used when ge_bad is 0
+    double                  ge_bad;                 // gilbert-elliott: probability to go from the good to the bad state per packet
+    double                  ge_good;                // gilbert-elliott: probability to go from the bad to the good state per packet
+    double                  ge_loss_good;           // gilbert-elliott: loss rate in the good state
+    double                  ge_loss_bad;            // gilbert-elliott: loss rate in the bad state
+    uint32_t                delay;                  // base one way delay
+    uint32_t                jitter;                 // uniform extra delay of 0 to jitter
+    double                  reorder;                // probability that a packet is held back by reorder_delay
+    uint32_t                reorder_delay;          // extra delay of a reordered packet
+    double                  duplicate;              // probability that a packet arrives twice
+    uint32_t                seed;                   // seed of the channel
+
+    sim_option_t()
+        : frames(150)
+        , fps(30)
+        , frame_size(50000)
+        , pace_millisecond(0)
+        , block_size(1100)
+        , recovery_rate(0.1)
+        , max_original_count(255)
+        , header_version(1)
+        , expire_millisecond(15)
+        , loss(0.02)
+        , ge_bad(0.0)
+        , ge_good(0.3)
+        , ge_loss_good(0.0)
+        , ge_loss_bad(0.5)
+        , delay(20)
+        , jitter(5)
+        , reorder(0.0)
+        , reorder_delay(10)
+        , duplicate(0.0)
+        , seed(1)
+    {
+
+    }
+};
+
+static bool parse_option(const char * arg, sim_option_t & option)
+{
+    std::string key;
+    const char * value = nullptr;
+    if (!tool_split_option(arg, key, value))
+    {
+        return false;
+    }
+
+    uint32_t * const uint_fields[] = { &option.frames, &option.fps, &option.frame_size, &option.pace_millisecond, &option.block_size, &option.max_original_count, &option.header_version, &option.expire_millisecond, &option.delay, &option.jitter, &option.reorder_delay, &option.seed };
+    const char * const uint_keys[] = { "frames", "fps", "frame_size", "pace", "block_size", "max_original_count", "header_version", "expire", "delay", "jitter", "reorder_delay", "seed" };
+
+    double * const double_fields[] = { &option.recovery_rate, &option.loss, &option.ge_bad, &option.ge_good, &option.ge_loss_good, &option.ge_loss_bad, &option.reorder, &option.duplicate };
+    const char * const double_keys[] = { "recovery_rate", "loss", "ge_bad", "ge_good", "ge_loss_good", "ge_loss_bad", "reorder", "duplicate" };
+
+    return tool_parse_option(key, value, uint_keys, uint_fields, sizeof(uint_keys) / sizeof(uint_keys[0])) || tool_parse_option(key, value, double_keys, double_fields, sizeof(double_keys) / sizeof(double_keys[0]));
+}
+
+/*
+ * the channel decides per packet: dropped (bernoulli, or gilbert-elliott when ge_bad is set),
+ * and else its arrival times, base delay plus uniform jitter, plus reorder_delay for reordered packets, twice for duplicates
+ */
+struct sim_channel_t
+{
+    const sim_option_t &    option;
+    tool_random_t           random;
+    bool                    bad_state;
+
+    sim_channel_t(const sim_option_t & sim_option)
+        : option(sim_option)
+        , random(sim_option.seed)
+        , bad_state(false)
+    {
+
+    }
+
+    bool drop()
+    {
+        if (0.0 == option.ge_bad)
+        {
+            return random.uniform() < option.loss;
+        }
+
+        bad_state = (bad_state ? random.uniform() >= option.ge_good : random.uniform() < option.ge_bad);
+        return random.uniform() < (bad_state ? option.ge_loss_bad : option.ge_loss_good);
+    }
+
+    uint64_t delay_microseconds()
+    {
+        uint64_t delay = static_cast<uint64_t>(option.delay) * 1000 + static_cast<uint64_t>(random.uniform() * option.jitter * 1000);
+        if (random.uniform() < option.reorder)
+        {
+            delay += static_cast<uint64_t>(option.reorder_delay) * 1000;
+        }
+        return delay;
+    }
+
+    uint32_t copies()
+    {
+        return (random.uniform() < option.duplicate ? 2 : 1);
+    }
+};
+
+/*
+ * frame content is derived from its index, so that a delivered frame can be checked without keeping the sent ones
+ */
+static void make_frame(uint32_t frame_index, uint32_t frame_size, std::vector<uint8_t> & frame)
+{
+    frame.resize(std::max<uint32_t>(frame_size, 4));
+    tool_random_t random(frame_index + 1);
+    for (std::vector<uint8_t>::iterator iter = frame.begin(); frame.end() != iter; ++iter)
+    {
+        *iter = static_cast<uint8_t>(random.next());
+    }
+    frame[0] = static_cast<uint8_t>(frame_index >> 24);
+    frame[1] = static_cast<uint8_t>(frame_index >> 16);
+    frame[2] = static_cast<uint8_t>(frame_index >> 8);
+    frame[3] = static_cast<uint8_t>(frame_index);
+}
+
+struct sim_result_t
+{
+    const sim_option_t *                option;
+    std::vector<uint64_t>               send_times;
+    std::vector<bool>                   delivered;
+    std::vector<double>                 latencies;
+    uint32_t                            corrupt_frames;
+    uint64_t                            delivered_bytes;
+    uint64_t                            sent_packets;
+    uint64_t                            lost_packets;
+    uint64_t                            wire_bytes;
+    double                              cpu_nanoseconds;
+    uint64_t                            now;
+
+    sim_result_t()
+        : option(nullptr)
+        , send_times()
+        , delivered()
+        , latencies()
+        , corrupt_frames(0)
+        , delivered_bytes(0)
+        , sent_packets(0)
+        , lost_packets(0)
+        , wire_bytes(0)
+        , cpu_nanoseconds(0.0)
+        , now(0)
+    {
+
+    }
+};
+
+static uint64_t sim_now(const sim_result_t & result)
+{
+    return result.now;
+}
+
+static uint64_t sim_decode_clock(void * user_data)
+{
+    return sim_now(*reinterpret_cast<const sim_result_t *>(user_data));
+}
+
+static void sim_frame_callback(void * user_data, const uint8_t * dst_data, uint32_t dst_size)
+{
+    sim_result_t & result = *reinterpret_cast<sim_result_t *>(user_data);
+
+    const uint32_t frame_index = (dst_size < 4 ? 0xffffffff : (static_cast<uint32_t>(dst_data[0]) << 24) | (static_cast<uint32_t>(dst_data[1]) << 16) | (static_cast<uint32_t>(dst_data[2]) << 8) | dst_data[3]);
+    std::vector<uint8_t> frame;
+    if (frame_index < result.delivered.size())
+    {
+        make_frame(frame_index, result.option->frame_size, frame);
+    }
+    if (frame.size() != dst_size || 0 != memcmp(&frame[0], dst_data, dst_size) || result.delivered[frame_index])
+    {
+        ++result.corrupt_frames;
+        return;
+    }
+
+    result.delivered[frame_index] = true;
+    result.delivered_bytes += dst_size;
+    result.latencies.push_back(static_cast<double>(sim_now(result) - result.send_times[frame_index]) / 1000.0);
+}
+
+static void sim_decode(CauchyFecDecoder & decoder, const uint8_t * data, uint32_t size, sim_result_t & result)
+{
+    const sim_clock_t::time_point begin = sim_clock_t::now();
+    decoder.decode(data, size, sim_frame_callback, &result);
+    result.cpu_nanoseconds += std::chrono::duration<double, std::nano>(sim_clock_t::now() - begin).count();
+}
+
+/*
+ * advances the simulated time, which is also the clock of the decoder, to the next event,
+ * the decoder is polled every millisecond on the way so that groups expire on time
+ */
+static void sim_wait_until(CauchyFecDecoder & decoder, uint64_t event_time, sim_result_t & result)
+{
+    while (result.now < event_time)
+    {
+        result.now = std::min<uint64_t>(event_time, result.now + 1000);
+        sim_decode(decoder, nullptr, 0, result);
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    sim_option_t option;
+    const char * capture_path = nullptr;
+    for (int index = 1; index < argc; ++index)
+    {
+        if (0 == strncmp(argv[index], "capture=", 8))
+        {
+            capture_path = argv[index] + 8;
+        }
+        else if (!parse_option(argv[index], option))
+        {
+            printf("usage: %s [key=value]...\n", argv[0]);
+            printf("  frames fps frame_size pace block_size recovery_rate max_original_count header_version expire\n");
+            printf("  loss ge_bad ge_good ge_loss_good ge_loss_bad delay jitter reorder reorder_delay duplicate seed\n");
+            printf("  capture (trace file of the decoder for cauchy_fec_replay)\n");
+            return 1;
+        }
+    }
+
+    encode_option_t encode_option;
+    encode_option.max_block_size = option.block_size;
+    encode_option.recovery_rate = option.recovery_rate;
+    encode_option.max_original_count = static_cast<uint8_t>(std::min<uint32_t>(option.max_original_count, 255));
+    encode_option.header_version = static_cast<uint8_t>(option.header_version);
+
+    CauchyFecEncoder encoder;
+    if (0 == option.fps || !encoder.init(encode_option))
+    {
+        printf("bad encode option\n");
+        return 2;
+    }
+
+    sim_result_t result;
+    result.option = &option;
+    result.send_times.resize(option.frames, 0);
+    result.delivered.resize(option.frames, false);
+
+    decode_option_t decode_option;
+    decode_option.expire_millisecond = option.expire_millisecond;
+    decode_option.clock = sim_decode_clock;
+    decode_option.clock_user_data = &result;
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(decode_option) || (nullptr != capture_path && !decoder.start_capture(capture_path)))
+    {
+        return 2;
+    }
+
+    sim_channel_t channel(option);
+    std::multimap<uint64_t, std::vector<uint8_t>> arrivals;
+
+    const uint64_t frame_interval = 1000000 / option.fps;
+
+    /*
+     * the sender runs ahead by one frame interval, packets arrive from the multimap in their arrival order,
+     * after the last frame all packets still in flight arrive before the final expiry wait
+     */
+    for (uint32_t frame_index = 0; frame_index <= option.frames; ++frame_index)
+    {
+        const uint64_t frame_time = frame_index * frame_interval;
+        const bool sent_all = (frame_index == option.frames);
+        while (!arrivals.empty() && (sent_all || arrivals.begin()->first < frame_time))
+        {
+            sim_wait_until(decoder, arrivals.begin()->first, result);
+            sim_decode(decoder, &arrivals.begin()->second[0], static_cast<uint32_t>(arrivals.begin()->second.size()), result);
+            arrivals.erase(arrivals.begin());
+        }
+
+        if (sent_all)
+        {
+            break;
+        }
+
+        sim_wait_until(decoder, frame_time, result);
+
+        std::vector<uint8_t> frame;
+        make_frame(frame_index, option.frame_size, frame);
+
+        std::list<std::vector<uint8_t>> packet_list;
+        const sim_clock_t::time_point encode_begin = sim_clock_t::now();
+        if (!encoder.encode(&frame[0], static_cast<uint32_t>(frame.size()), packet_list))
+        {
+            printf("encode failed\n");
+            return 3;
+        }
+        result.cpu_nanoseconds += std::chrono::duration<double, std::nano>(sim_clock_t::now() - encode_begin).count();
+        result.send_times[frame_index] = sim_now(result);
+
+        uint32_t packet_index = 0;
+        for (std::list<std::vector<uint8_t>>::iterator iter = packet_list.begin(); packet_list.end() != iter; ++iter, ++packet_index)
+        {
+            const uint64_t send_time = result.send_times[frame_index] + static_cast<uint64_t>(option.pace_millisecond) * 1000 * packet_index / packet_list.size();
+            ++result.sent_packets;
+            result.wire_bytes += iter->size();
+            if (channel.drop())
+            {
+                ++result.lost_packets;
+                continue;
+            }
+            for (uint32_t copy = channel.copies(); 0 != copy; --copy)
+            {
+                arrivals.insert(std::make_pair(send_time + channel.delay_microseconds(), *iter));
+            }
+        }
+    }
+
+    sim_wait_until(decoder, sim_now(result) + static_cast<uint64_t>(option.expire_millisecond) * 2000 + 10000, result);
+
+    const double seconds = static_cast<double>(option.frames) / option.fps;
+    const uint32_t delivered_frames = static_cast<uint32_t>(result.latencies.size());
+
+    tool_json_t json("", " ");
+    json.number("frames", option.frames);
+    json.number("fps", option.fps);
+    json.number("frame_size", option.frame_size);
+    json.number("block_size", option.block_size);
+    json.real("recovery_rate", option.recovery_rate, 3);
+    json.number("max_original_count", option.max_original_count);
+    json.number("header_version", option.header_version);
+    json.number("expire", option.expire_millisecond);
+    json.wrap();
+    json.real("loss", option.loss, 4);
+    json.real("ge_bad", option.ge_bad, 4);
+    json.real("ge_good", option.ge_good, 4);
+    json.real("ge_loss_good", option.ge_loss_good, 4);
+    json.real("ge_loss_bad", option.ge_loss_bad, 4);
+    json.number("delay", option.delay);
+    json.number("jitter", option.jitter);
+    json.real("reorder", option.reorder, 4);
+    json.number("reorder_delay", option.reorder_delay);
+    json.real("duplicate", option.duplicate, 4);
+    json.number("seed", option.seed);
+    json.wrap();
+    json.real("packet_loss_rate", static_cast<double>(result.lost_packets) / std::max<uint64_t>(result.sent_packets, 1), 4);
+    json.real("overhead", static_cast<double>(result.wire_bytes) / (static_cast<double>(option.frame_size) * option.frames) - 1.0, 4);
+    json.real("goodput_mbit_s", result.delivered_bytes * 8.0 / seconds / 1000000.0, 3);
+    json.real("residual_frame_loss_rate", 1.0 - static_cast<double>(delivered_frames) / option.frames, 4);
+    json.number("corrupt_frames", result.corrupt_frames);
+    json.wrap();
+    json.real("latency_p50_ms", tool_percentile(result.latencies, 0.5), 2);
+    json.real("latency_p90_ms", tool_percentile(result.latencies, 0.9), 2);
+    json.real("latency_p99_ms", tool_percentile(result.latencies, 0.99), 2);
+    json.real("latency_max_ms", tool_percentile(result.latencies, 1.0), 2);
+    json.real("cpu_ns_per_byte", result.cpu_nanoseconds / std::max<uint64_t>(result.delivered_bytes, 1), 3);
+
+    decode_counters_t decode_counters;
+    decoder.get_counters(decode_counters);
+    json.wrap();
+    json.number("duplicate_packets", decode_counters.duplicate_packets);
+    json.number("stale_packets", decode_counters.stale_packets);
+    json.number("complete_groups", decode_counters.complete_groups);
+    json.number("recovered_groups", decode_counters.recovered_groups);
+    json.number("expired_groups", decode_counters.expired_groups);
+    json.number("recovered_blocks", decode_counters.recovered_blocks);
+    json.number("dropped_frames", decode_counters.dropped_frames);
+    json.number("evicted_groups", decode_counters.evicted_groups);
+
+    /* time inside the decoder, from the first block to the decoded group or the delivered frame, to set expire against */
+    decode_latency_t decode_latency;
+    decoder.get_latency(decode_latency);
+    json.wrap();
+    json.real("group_wait_p50_ms", decode_latency.group_latency.percentile(0.5) / 1000.0, 2);
+    json.real("group_wait_p99_ms", decode_latency.group_latency.percentile(0.99) / 1000.0, 2);
+    json.real("frame_wait_p50_ms", decode_latency.frame_latency.percentile(0.5) / 1000.0, 2);
+    json.real("frame_wait_p99_ms", decode_latency.frame_latency.percentile(0.99) / 1000.0, 2);
+    json.real("frame_wait_max_ms", decode_latency.frame_latency.max_value / 1000.0, 2);
+    json.real("cauchy_decode_p99_us", decode_latency.decode_time.percentile(0.99) / 1000.0, 2);
+    json.close("\n");
+
+    return 0;
+}
@@ -14,6 +14,7 @@
 #endif // _MSC_VER
 
 #include <ctime>
+#include <cstdio>
 #include <iostream>
 #include <algorithm>
 #include "cauchy_fec.h"
@@ -33,6 +34,1192 @@ static void get_system_time(int32_t & seconds, int32_t & microseconds)
 #endif // _MSC_VER
 }
 
+static uint64_t manual_clock(void * user_data)
+{
+    return *reinterpret_cast<const uint64_t *>(user_data);
+}
+
+static bool multi_group_round_trip(const std::vector<uint8_t> & src_data)
+{
+    CauchyFecEncoder encoder;
+    if (!encoder.init(200, 0.1, true))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> tmp_list;
+    if (!encoder.encode(&src_data[0], static_cast<uint32_t>(src_data.size()), tmp_list))
+    {
+        return false;
+    }
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(30))
+    {
+        return false;
+    }
+
+    /* a frame of several groups, each of them repaired */
+    std::list<std::vector<uint8_t>> dst_list;
+
+    uint32_t index = 0;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        if (0 == ++index % 40)
+        {
+            continue;
+        }
+        const std::vector<uint8_t> & data = *iter;
+        decoder.decode(&data[0], static_cast<uint32_t>(data.size()), dst_list);
+    }
+
+    return 1 == dst_list.size() && dst_list.front() == src_data;
+}
+
+static void collect_block(void * user_data, const uint8_t * dst_data, uint32_t dst_size)
+{
+    reinterpret_cast<std::list<std::vector<uint8_t>> *>(user_data)->emplace_back(dst_data, dst_data + dst_size);
+}
+
+static bool callback_round_trip(const std::vector<uint8_t> & src_data)
+{
+    CauchyFecEncoder encoder;
+    if (!encoder.init(1100, 0.1, true))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> tmp_list;
+    if (!encoder.encode(&src_data[0], static_cast<uint32_t>(src_data.size()), collect_block, &tmp_list))
+    {
+        return false;
+    }
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(30))
+    {
+        return false;
+    }
+
+    /* the recovery blocks handed to the callback must repair the lost ones */
+    std::list<std::vector<uint8_t>> dst_list;
+
+    uint32_t index = 0;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        if (0 == ++index % 20)
+        {
+            continue;
+        }
+        const std::vector<uint8_t> & data = *iter;
+        decoder.decode(&data[0], static_cast<uint32_t>(data.size()), dst_list);
+    }
+
+    return 1 == dst_list.size() && dst_list.front() == src_data;
+}
+
+static bool round_trip(const encode_option_t & option, const std::vector<uint8_t> & src_data, uint32_t loss_interval, uint32_t burst_begin = 0, uint32_t burst_size = 0)
+{
+    CauchyFecEncoder encoder;
+    if (!encoder.init(option))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> tmp_list;
+    if (!encoder.encode(&src_data[0], static_cast<uint32_t>(src_data.size()), tmp_list))
+    {
+        return false;
+    }
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(30))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> dst_list;
+
+    uint32_t index = 0;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        ++index;
+        if ((0 != loss_interval && 0 == index % loss_interval) || (index > burst_begin && index <= burst_begin + burst_size))
+        {
+            continue;
+        }
+        const std::vector<uint8_t> & data = *iter;
+        decoder.decode(&data[0], static_cast<uint32_t>(data.size()), dst_list);
+    }
+
+    return 1 == dst_list.size() && dst_list.front() == src_data;
+}
+
+static bool aggregate_round_trip(const std::vector<uint8_t> & src_data)
+{
+    encode_option_t option;
+    option.header_version = 2;
+    option.aggregate_bytes = 4000;
+    option.aggregate_millisecond = 1000;
+
+    CauchyFecEncoder encoder;
+    if (!encoder.init(option))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> src_list;
+    std::list<std::vector<uint8_t>> tmp_list;
+    for (uint32_t frame_size = 1; frame_size < 600; frame_size += 37)
+    {
+        src_list.emplace_back(src_data.begin() + frame_size, src_data.begin() + frame_size * 2);
+        if (!encoder.encode(&src_list.back()[0], frame_size, tmp_list))
+        {
+            return false;
+        }
+    }
+    if (!encoder.flush(tmp_list))
+    {
+        return false;
+    }
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(30))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> dst_list;
+
+    uint32_t index = 0;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        if (0 == ++index % 3)
+        {
+            continue;
+        }
+        const std::vector<uint8_t> & data = *iter;
+        decoder.decode(&data[0], static_cast<uint32_t>(data.size()), dst_list);
+    }
+
+    return tmp_list.size() < src_list.size() && dst_list == src_list;
+}
+
+static bool frame_option_round_trip(const std::vector<uint8_t> & src_data)
+{
+    CauchyFecEncoder encoder;
+    if (!encoder.init(1100, 0.1, true))
+    {
+        return false;
+    }
+
+    frame_option_t key_option;
+    key_option.recovery_rate = 0.3;
+    key_option.max_original_count = 32;
+    key_option.priority = 1;
+
+    frame_option_t bulk_option;
+    bulk_option.recovery_rate = 0.0;
+
+    encode_stats_t key_stats;
+    encode_stats_t bulk_stats;
+    std::list<std::vector<uint8_t>> key_list;
+    std::list<std::vector<uint8_t>> bulk_list;
+    if (!encoder.encode(&src_data[0], static_cast<uint32_t>(src_data.size()), key_option, key_list) || !encoder.get_stats(key_stats) ||
+        !encoder.encode(&src_data[0], static_cast<uint32_t>(src_data.size()), bulk_option, bulk_list) || !encoder.get_stats(bulk_stats))
+    {
+        return false;
+    }
+
+    if (key_stats.group_count < 9 || key_stats.recovery_count * 10 < key_stats.original_count * 4 || 0 != bulk_stats.recovery_count)
+    {
+        return false;
+    }
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(30))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> dst_list;
+
+    uint32_t index = 0;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = key_list.begin(); key_list.end() != iter; ++iter)
+    {
+        if (0 == ++index % 4)
+        {
+            continue;
+        }
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = bulk_list.begin(); bulk_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    return 2 == dst_list.size() && dst_list.front() == src_data && dst_list.back() == src_data;
+}
+
+static bool protect_round_trip(const std::vector<uint8_t> & src_data)
+{
+    encode_option_t option;
+    option.header_version = 2;
+    option.recovery_rate = 0.0;
+
+    CauchyFecEncoder encoder;
+    if (!encoder.init(option))
+    {
+        return false;
+    }
+
+    frame_option_t frame_option;
+    frame_option.protect_ranges.push_back(protect_range_t(0, 20000, 0.5));
+
+    encode_stats_t encode_stats;
+    std::list<std::vector<uint8_t>> tmp_list;
+    if (!encoder.encode(&src_data[0], static_cast<uint32_t>(src_data.size()), frame_option, tmp_list) || !encoder.get_stats(encode_stats))
+    {
+        return false;
+    }
+
+    if (0 == encode_stats.recovery_count || encode_stats.recovery_count * 10 > encode_stats.original_count)
+    {
+        return false;
+    }
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(30))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> dst_list;
+
+    /* only the protected prefix has recovery blocks, it is the one that loses packets */
+    uint32_t index = 0;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        if (index++ < encode_stats.recovery_count && 0 == index % 4)
+        {
+            continue;
+        }
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    return 1 == dst_list.size() && dst_list.front() == src_data;
+}
+
+/*
+ * the receiver loses every 10th packet for a while and nothing afterwards,
+ * the recovery rate of the sender has to follow the reports up and down again
+ */
+static bool adaptive_round_trip(const std::vector<uint8_t> & src_data)
+{
+    encode_option_t option;
+    option.adaptive_recovery = true;
+
+    CauchyFecEncoder encoder;
+    if (!encoder.init(option))
+    {
+        return false;
+    }
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(30))
+    {
+        return false;
+    }
+
+    double lossy_rate = 0.0;
+    double clean_rate = 0.0;
+
+    uint32_t index = 0;
+    for (uint32_t frame = 0; frame < 60; ++frame)
+    {
+        std::list<std::vector<uint8_t>> tmp_list;
+        encode_stats_t encode_stats;
+        if (!encoder.encode(&src_data[0], static_cast<uint32_t>(src_data.size()), tmp_list) || !encoder.get_stats(encode_stats))
+        {
+            return false;
+        }
+
+        std::list<std::vector<uint8_t>> dst_list;
+        for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+        {
+            if (frame < 30 && 0 == ++index % 10)
+            {
+                continue;
+            }
+            decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+        }
+
+        receive_report_t receive_report;
+        if (!decoder.get_report(receive_report) || !encoder.feedback(receive_report))
+        {
+            return false;
+        }
+
+        const double recovery_rate = static_cast<double>(encode_stats.recovery_count) / (encode_stats.original_count + encode_stats.recovery_count);
+        if (29 == frame)
+        {
+            lossy_rate = recovery_rate;
+        }
+        else if (59 == frame)
+        {
+            clean_rate = recovery_rate;
+        }
+    }
+
+    return lossy_rate > 0.15 && clean_rate < 0.05;
+}
+
+/*
+ * a group sent without recovery blocks loses three packets and is repaired with exactly three new ones
+ */
+static bool repair_round_trip(const std::vector<uint8_t> & src_data)
+{
+    encode_option_t option;
+    option.recovery_rate = 0.0;
+    option.force_recovery = false;
+    option.repair_cache_groups = 4;
+
+    CauchyFecEncoder encoder;
+    if (!encoder.init(option))
+    {
+        return false;
+    }
+
+    const uint32_t src_size = 20000;
+    std::list<std::vector<uint8_t>> tmp_list;
+    if (!encoder.encode(&src_data[0], src_size, tmp_list))
+    {
+        return false;
+    }
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(30))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> dst_list;
+
+    uint32_t index = 0;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        if (0 == ++index % 5)
+        {
+            continue;
+        }
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    std::list<std::vector<uint8_t>> repair_list;
+    if (!dst_list.empty() || !encoder.repair(0, 3, repair_list) || 3 != repair_list.size())
+    {
+        return false;
+    }
+
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = repair_list.begin(); repair_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    return 1 == dst_list.size() && std::equal(dst_list.front().begin(), dst_list.front().end(), src_data.begin()) && src_size == dst_list.front().size();
+}
+
+/*
+ * the decoder asks for the missing blocks of a group before it expires, the encoder answers the nack from its repair cache
+ */
+static bool nack_round_trip(const std::vector<uint8_t> & src_data)
+{
+    encode_option_t option;
+    option.header_version = 2;
+    option.recovery_rate = 0.0;
+    option.force_recovery = false;
+    option.repair_cache_groups = 4;
+
+    CauchyFecEncoder encoder;
+    if (!encoder.init(option))
+    {
+        return false;
+    }
+
+    const uint32_t src_size = 20000;
+    std::list<std::vector<uint8_t>> tmp_list;
+    if (!encoder.encode(&src_data[0], src_size, tmp_list))
+    {
+        return false;
+    }
+
+    uint64_t current_time = 1000000;
+    decode_option_t decode_option;
+    decode_option.expire_millisecond = 1000;
+    decode_option.nack_millisecond = 5;
+    decode_option.clock = manual_clock;
+    decode_option.clock_user_data = &current_time;
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(decode_option))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> dst_list;
+
+    uint32_t index = 0;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        if (0 == ++index % 5)
+        {
+            continue;
+        }
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    std::vector<uint8_t> nack_data;
+    current_time += 6000;
+    if (!decoder.nack(nack_data))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> repair_list;
+    if (!dst_list.empty() || !encoder.repair_nack(&nack_data[0], static_cast<uint32_t>(nack_data.size()), repair_list) || 3 != repair_list.size())
+    {
+        return false;
+    }
+
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = repair_list.begin(); repair_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    return 1 == dst_list.size() && src_size == dst_list.front().size() && std::equal(dst_list.front().begin(), dst_list.front().end(), src_data.begin()) && !decoder.nack(nack_data);
+}
+
+/*
+ * with sender timestamps a group is due by its own timestamp, not by the arrival of its first block:
+ * a frame sent a second late expires at once and does not hold back the frame behind it
+ */
+static bool timestamp_round_trip(const std::vector<uint8_t> & src_data)
+{
+    encode_option_t option;
+    option.header_version = 2;
+    option.send_timestamp = true;
+
+    CauchyFecEncoder encoder;
+    if (!encoder.init(option))
+    {
+        return false;
+    }
+
+    uint64_t current_time = 1000000000;
+    decode_option_t decode_option;
+    decode_option.expire_millisecond = 1000;
+    decode_option.clock = manual_clock;
+    decode_option.clock_user_data = &current_time;
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(decode_option))
+    {
+        return false;
+    }
+
+    const uint32_t timestamp = static_cast<uint32_t>(current_time / 1000);
+
+    const uint32_t src_size = 20000;
+    std::list<std::vector<uint8_t>> dst_list;
+
+    for (uint32_t frame = 0; frame < 3; ++frame)
+    {
+        frame_option_t frame_option;
+        frame_option.timestamp = (1 == frame ? timestamp - 2000 : timestamp);
+
+        std::list<std::vector<uint8_t>> tmp_list;
+        if (!encoder.encode(&src_data[0], src_size, frame_option, tmp_list))
+        {
+            return false;
+        }
+
+        uint32_t index = 0;
+        for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+        {
+            if (1 == frame && 0 == ++index % 2)
+            {
+                continue;
+            }
+            decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+        }
+    }
+
+    return 2 == dst_list.size() && src_size == dst_list.back().size() && std::equal(dst_list.back().begin(), dst_list.back().end(), src_data.begin());
+}
+
+static bool playout_round_trip(const std::vector<uint8_t> & src_data)
+{
+    encode_option_t option;
+    option.header_version = 2;
+    option.send_timestamp = true;
+
+    CauchyFecEncoder encoder;
+    if (!encoder.init(option))
+    {
+        return false;
+    }
+
+    uint64_t current_time = 1000000000;
+    decode_option_t decode_option;
+    decode_option.expire_millisecond = 1000;
+    decode_option.playout_millisecond = 50;
+    decode_option.clock = manual_clock;
+    decode_option.clock_user_data = &current_time;
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(decode_option))
+    {
+        return false;
+    }
+
+    const uint32_t timestamp = static_cast<uint32_t>(current_time / 1000);
+
+    const uint32_t src_size = 20000;
+    std::list<std::vector<uint8_t>> dst_list;
+
+    /* the second frame is stamped long before the first one was due, it is late and follows the held first frame */
+    for (uint32_t frame = 0; frame < 2; ++frame)
+    {
+        frame_option_t frame_option;
+        frame_option.timestamp = (1 == frame ? timestamp - 2000 : timestamp);
+
+        std::list<std::vector<uint8_t>> tmp_list;
+        if (!encoder.encode(&src_data[0], src_size, frame_option, tmp_list))
+        {
+            return false;
+        }
+
+        for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+        {
+            decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+        }
+    }
+
+    playout_stats_t playout_stats;
+    if (!dst_list.empty() || !decoder.get_playout_stats(playout_stats) || 2 != playout_stats.held_frames || 1 != playout_stats.late_frames || 0 == playout_stats.wait_millisecond)
+    {
+        return false;
+    }
+
+    /* both go 50 ms after the first one was due */
+    current_time += 49000;
+    decoder.decode(nullptr, 0, dst_list);
+    if (!dst_list.empty())
+    {
+        return false;
+    }
+
+    current_time += 1000;
+    decoder.decode(nullptr, 0, dst_list);
+    return 2 == dst_list.size() && decoder.get_playout_stats(playout_stats) && 2 == playout_stats.released_frames && 0 == playout_stats.held_frames &&
+        src_size == dst_list.back().size() && std::equal(dst_list.back().begin(), dst_list.back().end(), src_data.begin());
+}
+
+/*
+ * two frames of several groups finish in one call, the one without timestamp waits behind the held timestamped one
+ */
+static bool playout_order_round_trip(const std::vector<uint8_t> & src_data)
+{
+    encode_option_t option;
+    option.header_version = 2;
+    option.max_original_count = 8;
+    option.recovery_rate = 0.0;
+    option.force_recovery = false;
+
+    CauchyFecEncoder plain_encoder;
+    if (!plain_encoder.init(option))
+    {
+        return false;
+    }
+
+    option.send_timestamp = true;
+    CauchyFecEncoder timestamp_encoder;
+    if (!timestamp_encoder.init(option))
+    {
+        return false;
+    }
+
+    uint64_t current_time = 1000000000;
+    decode_option_t decode_option;
+    decode_option.expire_millisecond = 1000;
+    decode_option.playout_millisecond = 50;
+    decode_option.clock = manual_clock;
+    decode_option.clock_user_data = &current_time;
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(decode_option))
+    {
+        return false;
+    }
+
+    /* the plain encoder skips the groups of the timestamped frame, so that its frame follows it */
+    const uint32_t src_size = 20000;
+    frame_option_t frame_option;
+    frame_option.timestamp = static_cast<uint32_t>(current_time / 1000);
+    std::list<std::vector<uint8_t>> timestamp_list;
+    std::list<std::vector<uint8_t>> skip_list;
+    std::list<std::vector<uint8_t>> plain_list;
+    if (!timestamp_encoder.encode(&src_data[0], src_size, frame_option, timestamp_list) ||
+        !plain_encoder.encode(&src_data[0], src_size, skip_list) || !plain_encoder.encode(&src_data[src_size], src_size, plain_list))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> dst_list;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = ++timestamp_list.begin(); timestamp_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = plain_list.begin(); plain_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+    decoder.decode(&timestamp_list.front()[0], static_cast<uint32_t>(timestamp_list.front().size()), dst_list);
+
+    playout_stats_t playout_stats;
+    if (!dst_list.empty() || !decoder.get_playout_stats(playout_stats) || 2 != playout_stats.held_frames)
+    {
+        return false;
+    }
+
+    current_time += 40000;
+    decoder.decode(nullptr, 0, dst_list);
+    if (!dst_list.empty())
+    {
+        return false;
+    }
+
+    current_time += 20000;
+    decoder.decode(nullptr, 0, dst_list);
+    return 2 == dst_list.size() && std::equal(dst_list.front().begin(), dst_list.front().end(), src_data.begin()) &&
+        std::equal(dst_list.back().begin(), dst_list.back().end(), src_data.begin() + src_size);
+}
+
+static bool partial_round_trip(const encode_option_t & option, const std::vector<uint8_t> & src_data)
+{
+    CauchyFecEncoder encoder;
+    if (!encoder.init(option))
+    {
+        return false;
+    }
+
+    uint64_t current_time = 1000000;
+    decode_option_t decode_option;
+    decode_option.expire_millisecond = 1;
+    decode_option.partial_frames = true;
+    decode_option.clock = manual_clock;
+    decode_option.clock_user_data = &current_time;
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(decode_option))
+    {
+        return false;
+    }
+
+    const uint32_t src_size = 20000;
+    std::list<std::vector<uint8_t>> tmp_list;
+    if (!encoder.encode(&src_data[0], src_size, tmp_list))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> dst_list;
+    std::list<std::vector<frame_range_t>> range_list;
+
+    /* two originals of the first group are lost, more than its recovery blocks can restore */
+    uint32_t index = 0;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        ++index;
+        if (3 == index || 4 == index)
+        {
+            continue;
+        }
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list, range_list);
+    }
+
+    if (!dst_list.empty())
+    {
+        return false;
+    }
+
+    current_time += 2000;
+    decoder.decode(nullptr, 0, dst_list, range_list);
+
+    if (1 != dst_list.size() || 1 != range_list.size() || src_size != dst_list.front().size() || 2 != range_list.front().size())
+    {
+        return false;
+    }
+
+    uint32_t valid_bytes = 0;
+    for (std::vector<frame_range_t>::const_iterator iter = range_list.front().begin(); range_list.front().end() != iter; ++iter)
+    {
+        if (!std::equal(dst_list.front().begin() + iter->offset, dst_list.front().begin() + iter->offset + iter->size, src_data.begin() + iter->offset))
+        {
+            return false;
+        }
+        valid_bytes += iter->size;
+    }
+
+    return valid_bytes < src_size && valid_bytes > src_size / 2;
+}
+
+static bool capture_round_trip(const std::vector<uint8_t> & src_data)
+{
+    CauchyFecEncoder encoder;
+    if (!encoder.init(1100, 0.1, true))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> tmp_list;
+    if (!encoder.encode(&src_data[0], 20000, tmp_list))
+    {
+        return false;
+    }
+
+    const char * trace_path = "cauchy_fec_test.trace";
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(15) || !decoder.start_capture(trace_path))
+    {
+        return false;
+    }
+
+    uint64_t packet_bytes = 0;
+    std::list<std::vector<uint8_t>> dst_list;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+        packet_bytes += iter->size();
+    }
+    decoder.stop_capture();
+
+    /* header, then at least two varint bytes and the packet per call */
+    FILE * file = fopen(trace_path, "rb");
+    if (nullptr == file)
+    {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    const long trace_size = ftell(file);
+    fclose(file);
+    remove(trace_path);
+
+    return 1 == dst_list.size() && trace_size >= static_cast<long>(18 + packet_bytes + tmp_list.size() * 2) && trace_size <= static_cast<long>(18 + packet_bytes + tmp_list.size() * 16);
+}
+
+/*
+ * on an injected clock the decoder times nacks and expiry by that clock alone
+ */
+static bool clock_round_trip(const std::vector<uint8_t> & src_data)
+{
+    encode_option_t encode_option;
+    encode_option.header_version = 2;
+    encode_option.recovery_rate = 0.0;
+    encode_option.force_recovery = false;
+
+    CauchyFecEncoder encoder;
+    if (!encoder.init(encode_option))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> tmp_list;
+    if (!encoder.encode(&src_data[0], 20000, tmp_list))
+    {
+        return false;
+    }
+
+    uint64_t current_time = 1000000;
+    decode_option_t decode_option;
+    decode_option.expire_millisecond = 15;
+    decode_option.nack_millisecond = 5;
+    decode_option.clock = manual_clock;
+    decode_option.clock_user_data = &current_time;
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(decode_option))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> dst_list;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = ++tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    std::vector<uint8_t> nack_data;
+    current_time += 4000;
+    if (decoder.nack(nack_data))
+    {
+        return false;
+    }
+    current_time += 2000;
+    if (!decoder.nack(nack_data))
+    {
+        return false;
+    }
+
+    receive_report_t receive_report;
+    current_time += 8000;
+    decoder.decode(nullptr, 0, dst_list);
+    if (!decoder.get_report(receive_report) || 0 != receive_report.lost_groups)
+    {
+        return false;
+    }
+    current_time += 2000;
+    decoder.decode(nullptr, 0, dst_list);
+    return decoder.get_report(receive_report) && 1 == receive_report.lost_groups && dst_list.empty();
+}
+
+/*
+ * one original block lost, one twice, the second recovery block arrives after its group was decoded
+ */
+static bool counters_round_trip(const std::vector<uint8_t> & src_data)
+{
+    CauchyFecEncoder encoder;
+    if (!encoder.init(1100, 0.1, true))
+    {
+        return false;
+    }
+
+    const uint32_t src_size = 20000;
+    std::list<std::vector<uint8_t>> tmp_list;
+    if (!encoder.encode(&src_data[0], src_size, tmp_list))
+    {
+        return false;
+    }
+
+    encode_counters_t encode_counters;
+    if (!encoder.get_counters(encode_counters) || 1 != encode_counters.input_frames || src_size != encode_counters.input_bytes || tmp_list.size() != encode_counters.output_packets)
+    {
+        return false;
+    }
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(15))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> dst_list;
+    std::list<std::vector<uint8_t>>::const_iterator iter = ++tmp_list.begin();
+    decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+
+    decode_counters_t decode_counters;
+    if (!decoder.get_counters(decode_counters) || 1 != decode_counters.buffered_groups || iter->size() >= decode_counters.buffered_bytes + 64)
+    {
+        return false;
+    }
+
+    for (; tmp_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    return decoder.get_counters(decode_counters) && 1 == dst_list.size() && 21 == tmp_list.size() &&
+        tmp_list.size() == decode_counters.input_packets && 1 == decode_counters.duplicate_packets && 1 == decode_counters.stale_packets &&
+        1 == decode_counters.recovered_groups && 1 == decode_counters.recovered_blocks && 1 == decode_counters.output_frames && src_size == decode_counters.output_bytes &&
+        0 == decode_counters.buffered_groups && 0 == decode_counters.buffered_bytes;
+}
+
+/*
+ * percentiles of merged histograms stay within the bucket width of the exact ones
+ */
+static bool histogram_round_trip(const std::vector<uint8_t> & src_data)
+{
+    latency_histogram_t odd_histogram;
+    latency_histogram_t even_histogram;
+    for (uint64_t value = 1; value <= 100000; ++value)
+    {
+        (0 != value % 2 ? odd_histogram : even_histogram).record(value);
+    }
+    odd_histogram.merge(even_histogram);
+
+    const uint64_t p50 = odd_histogram.percentile(0.5);
+    const uint64_t p99 = odd_histogram.percentile(0.99);
+    if (100000 != odd_histogram.total_count || 1 != odd_histogram.min_value || 100000 != odd_histogram.percentile(1.0) ||
+        p50 < 50000 || p50 > 50000 + 50000 / 16 || p99 < 99000 || p99 > 99000 + 99000 / 16)
+    {
+        return false;
+    }
+
+    CauchyFecEncoder encoder;
+    CauchyFecDecoder decoder;
+    if (!encoder.init(1100, 0.1, true) || !decoder.init(15))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> tmp_list;
+    std::list<std::vector<uint8_t>> dst_list;
+    if (!encoder.encode(&src_data[0], 20000, tmp_list))
+    {
+        return false;
+    }
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = ++tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    encode_latency_t encode_latency;
+    decode_latency_t decode_latency;
+    return encoder.get_latency(encode_latency) && decoder.get_latency(decode_latency) && 1 == dst_list.size() &&
+        1 == encode_latency.encode_time.total_count && 1 == decode_latency.group_latency.total_count &&
+        1 == decode_latency.frame_latency.total_count && 1 == decode_latency.decode_time.total_count;
+}
+
+/*
+ * groups past the budget are evicted oldest first, the groups after them still decode
+ */
+static bool budget_round_trip(const std::vector<uint8_t> & src_data)
+{
+    CauchyFecEncoder encoder;
+    if (!encoder.init(1100, 0.1, true))
+    {
+        return false;
+    }
+
+    decode_option_t option;
+    option.expire_millisecond = 1000;
+    option.max_buffered_groups = 4;
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(option))
+    {
+        return false;
+    }
+
+    /* the first block of ten groups, the rest of the last four groups follows */
+    const uint32_t src_size = 20000;
+    std::list<std::vector<uint8_t>> rest_list;
+    std::list<std::vector<uint8_t>> dst_list;
+    decode_counters_t decode_counters;
+    for (uint32_t frame = 0; frame < 10; ++frame)
+    {
+        std::list<std::vector<uint8_t>> tmp_list;
+        if (!encoder.encode(&src_data[0], src_size, tmp_list))
+        {
+            return false;
+        }
+
+        decoder.decode(&tmp_list.front()[0], static_cast<uint32_t>(tmp_list.front().size()), dst_list);
+        if (!decoder.get_counters(decode_counters) || decode_counters.buffered_groups > option.max_buffered_groups)
+        {
+            return false;
+        }
+
+        if (frame >= 6)
+        {
+            rest_list.splice(rest_list.end(), tmp_list, ++tmp_list.begin(), tmp_list.end());
+        }
+    }
+
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = rest_list.begin(); rest_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    return decoder.get_counters(decode_counters) && 6 == decode_counters.evicted_groups && 0 != decode_counters.evicted_bytes && 0 == decode_counters.buffered_groups &&
+        4 == dst_list.size() && src_size == dst_list.back().size() && std::equal(dst_list.back().begin(), dst_list.back().end(), src_data.begin());
+}
+
+/*
+ * standard group ids stay below 0xce << 56, a standard header with a higher id would start like a compact one and is not taken
+ */
+static bool group_id_round_trip(const std::vector<uint8_t> & src_data)
+{
+    CauchyFecEncoder encoder;
+    if (!encoder.init(1100, 0.1, true))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> tmp_list;
+    if (!encoder.encode(&src_data[0], 5000, tmp_list) || !CauchyFecDecoder::recognizable(&tmp_list.front()[0], static_cast<uint32_t>(tmp_list.front().size())))
+    {
+        return false;
+    }
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(30))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> dst_list;
+    for (std::list<std::vector<uint8_t>>::iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        (*iter)[0] = 0xcf;
+        if (CauchyFecDecoder::recognizable(&(*iter)[0], static_cast<uint32_t>(iter->size())))
+        {
+            return false;
+        }
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    return dst_list.empty();
+}
+
+/*
+ * a compact packet of a group of one block whose stream is a single whole-frame record of frame_size bytes, payload_size of them sent
+ */
+static void make_record_packet(uint16_t group_id, uint32_t frame_size, uint32_t payload_size, std::vector<uint8_t> & packet)
+{
+    const uint8_t head[] = { 0xce, 0x00, static_cast<uint8_t>(group_id >> 8), static_cast<uint8_t>(group_id), 0x00, 0x01, 0x00 };
+    packet.assign(head, head + sizeof(head));
+
+    const uint32_t record[] = { frame_size, 0, 0, 1, frame_size };
+    for (uint32_t index = 0; index < sizeof(record) / sizeof(record[0]); ++index)
+    {
+        uint32_t value = record[index];
+        while (value >= 0x80)
+        {
+            packet.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        packet.push_back(static_cast<uint8_t>(value));
+    }
+
+    packet.insert(packet.end(), payload_size, 0x5a);
+}
+
+/*
+ * the size of a whole-frame record is checked against the bytes that arrived before the frame is allocated, with and without a budget
+ */
+static bool forged_record_round_trip()
+{
+    decode_option_t option;
+    option.max_buffered_bytes = 0;
+
+    CauchyFecDecoder unbounded_decoder;
+    CauchyFecDecoder bounded_decoder;
+    if (!unbounded_decoder.init(option) || !bounded_decoder.init(30))
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> packet;
+    std::list<std::vector<uint8_t>> dst_list;
+    decode_counters_t decode_counters;
+
+    make_record_packet(1, 0xffffffff, 16, packet);
+    unbounded_decoder.decode(&packet[0], static_cast<uint32_t>(packet.size()), dst_list);
+    bounded_decoder.decode(&packet[0], static_cast<uint32_t>(packet.size()), dst_list);
+    if (!dst_list.empty() || !unbounded_decoder.get_counters(decode_counters) || 1 != decode_counters.failed_groups || 0 != decode_counters.buffered_bytes)
+    {
+        return false;
+    }
+
+    make_record_packet(2, 3000, 2999, packet);
+    bounded_decoder.decode(&packet[0], static_cast<uint32_t>(packet.size()), dst_list);
+    if (!dst_list.empty() || !bounded_decoder.get_counters(decode_counters) || 2 != decode_counters.failed_groups)
+    {
+        return false;
+    }
+
+    make_record_packet(3, 3000, 3000, packet);
+    bounded_decoder.decode(&packet[0], static_cast<uint32_t>(packet.size()), dst_list);
+    return 1 == dst_list.size() && std::vector<uint8_t>(3000, 0x5a) == dst_list.front();
+}
+
+/*
+ * compact header under a byte budget: a frame in assembly over several groups is given up with the group it needs,
+ * the late blocks of that group are stale instead of rebuilding it, and a later whole-record frame still gets through
+ */
+static bool budget_bytes_round_trip(const std::vector<uint8_t> & src_data)
+{
+    encode_option_t encode_option;
+    encode_option.header_version = 2;
+    encode_option.max_original_count = 8;
+
+    CauchyFecEncoder encoder;
+    if (!encoder.init(encode_option))
+    {
+        return false;
+    }
+
+    decode_option_t option;
+    option.expire_millisecond = 1000;
+    option.max_buffered_bytes = 45000;
+
+    CauchyFecDecoder decoder;
+    if (!decoder.init(option))
+    {
+        return false;
+    }
+
+    /* the packets of the first two groups of a 40000 byte frame, by the group id of their compact header */
+    std::list<std::vector<uint8_t>> tmp_list;
+    if (!encoder.encode(&src_data[0], 40000, tmp_list))
+    {
+        return false;
+    }
+
+    std::list<std::vector<uint8_t>> first_list;
+    std::list<std::vector<uint8_t>> second_list;
+    const uint8_t first_group = tmp_list.front()[3];
+    for (std::list<std::vector<uint8_t>>::iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        if (first_group == (*iter)[3])
+        {
+            first_list.push_back(*iter);
+        }
+        else if (static_cast<uint8_t>(first_group + 1) == (*iter)[3])
+        {
+            second_list.push_back(*iter);
+        }
+    }
+
+    std::list<std::vector<uint8_t>> dst_list;
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = first_list.begin(); first_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    decode_counters_t decode_counters;
+    if (!decoder.get_counters(decode_counters) || 40000 != decode_counters.buffered_bytes || 0 != decode_counters.evicted_groups)
+    {
+        return false;
+    }
+
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = second_list.begin(); second_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    if (!decoder.get_counters(decode_counters) || 1 != decode_counters.evicted_groups || 1 != decode_counters.evicted_frames ||
+        0 != decode_counters.buffered_bytes || 0 == decode_counters.stale_packets || !dst_list.empty())
+    {
+        return false;
+    }
+
+    tmp_list.clear();
+    if (!encoder.encode(&src_data[0], 5000, tmp_list))
+    {
+        return false;
+    }
+
+    for (std::list<std::vector<uint8_t>>::const_iterator iter = tmp_list.begin(); tmp_list.end() != iter; ++iter)
+    {
+        decoder.decode(&(*iter)[0], static_cast<uint32_t>(iter->size()), dst_list);
+    }
+
+    return 1 == dst_list.size() && 5000 == dst_list.front().size() && std::equal(dst_list.front().begin(), dst_list.front().end(), src_data.begin());
+}
+
 int main()
 {
     std::vector<uint8_t> src_data(307608, 0x0);
@@ -133,6 +1320,158 @@ int main()
         return 5;
     }
 
+    if (!multi_group_round_trip(src_data))
+    {
+        return 6;
+    }
+
+    if (!callback_round_trip(src_data))
+    {
+        return 7;
+    }
+
+    encode_option_t compact_option;
+    compact_option.header_version = 2;
+    if (!round_trip(compact_option, src_data, 20))
+    {
+        return 8;
+    }
+
+    encode_option_t balanced_option;
+    balanced_option.balanced_groups = true;
+    if (!round_trip(balanced_option, src_data, 20))
+    {
+        return 9;
+    }
+
+    encode_option_t adaptive_option;
+    adaptive_option.adaptive_block_size = true;
+    if (!round_trip(adaptive_option, src_data, 20) || !round_trip(adaptive_option, std::vector<uint8_t>(src_data.begin(), src_data.begin() + 1200), 0))
+    {
+        return 10;
+    }
+
+    encode_option_t shorten_option;
+    shorten_option.shorten_last_block = true;
+    shorten_option.adaptive_block_size = true;
+    if (!round_trip(shorten_option, src_data, 20) || !round_trip(shorten_option, std::vector<uint8_t>(src_data.begin(), src_data.begin() + 1500), 2))
+    {
+        return 11;
+    }
+
+    encode_option_t small_group_option;
+    small_group_option.max_original_count = 16;
+    if (!round_trip(small_group_option, src_data, 10))
+    {
+        return 12;
+    }
+
+    if (!aggregate_round_trip(src_data))
+    {
+        return 13;
+    }
+
+    encode_option_t interleave_option;
+    interleave_option.balanced_groups = true;
+    interleave_option.interleave_depth = 2;
+    if (round_trip(balanced_option, src_data, 0, 50, 30) || !round_trip(interleave_option, src_data, 0, 50, 30))
+    {
+        return 14;
+    }
+
+    if (!frame_option_round_trip(src_data))
+    {
+        return 15;
+    }
+
+    if (!protect_round_trip(src_data))
+    {
+        return 16;
+    }
+
+    if (!adaptive_round_trip(src_data))
+    {
+        return 17;
+    }
+
+    if (!repair_round_trip(src_data))
+    {
+        return 18;
+    }
+
+    if (!nack_round_trip(src_data))
+    {
+        return 19;
+    }
+
+    if (!timestamp_round_trip(src_data))
+    {
+        return 20;
+    }
+
+    if (!playout_round_trip(src_data))
+    {
+        return 21;
+    }
+
+    encode_option_t partial_option;
+    partial_option.max_original_count = 8;
+    if (!partial_round_trip(partial_option, src_data))
+    {
+        return 22;
+    }
+
+    partial_option.header_version = 2;
+    if (!partial_round_trip(partial_option, src_data))
+    {
+        return 23;
+    }
+
+    if (!capture_round_trip(src_data))
+    {
+        return 24;
+    }
+
+    if (!clock_round_trip(src_data))
+    {
+        return 25;
+    }
+
+    if (!counters_round_trip(src_data))
+    {
+        return 26;
+    }
+
+    if (!histogram_round_trip(src_data))
+    {
+        return 27;
+    }
+
+    if (!budget_round_trip(src_data))
+    {
+        return 28;
+    }
+
+    if (!playout_order_round_trip(src_data))
+    {
+        return 29;
+    }
+
+    if (!group_id_round_trip(src_data))
+    {
+        return 30;
+    }
+
+    if (!forged_record_round_trip())
+    {
+        return 31;
+    }
+
+    if (!budget_bytes_round_trip(src_data))
+    {
+        return 32;
+    }
+
     std::cout << "ok" << std::endl;
 
     return 0;
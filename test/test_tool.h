@@ -0,0 +1,166 @@
+/********************************************************
+ * Description : helpers shared by the cauchy fec test tools
+ * Author      : yanrk
+ * Email       : yanrkchina@163.com
+ * Version     : 1.0
+ * History     :
+ * Copyright(C): 2025
+ ********************************************************/
+
+#ifndef CAUCHY_FEC_TEST_TOOL_H
+#define CAUCHY_FEC_TEST_TOOL_H
+
+
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+/*
+ * xorshift32, reproducible across runs and releases for the same seed, a seed of 0 is replaced as it would stay 0
+ */
+struct tool_random_t
+{
+    uint32_t                state;
+
+    explicit tool_random_t(uint32_t seed)
+        : state(0 != seed ? seed : 0x9e3779b9)
+    {
+
+    }
+
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    double uniform()
+    {
+        return static_cast<double>(next()) / 4294967296.0;
+    }
+};
+
+/*
+ * nearest rank of the sorted samples, rank 0.5 is the median and 1.0 the maximum, 0 without samples
+ */
+inline double tool_percentile(std::vector<double> & samples, double rank)
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[static_cast<std::size_t>(rank * (samples.size() - 1) + 0.5)];
+}
+
+/*
+ * command line parameters as key=value: the key is looked up in a table of keys and the value stored to the field of the same index
+ */
+inline bool tool_split_option(const char * arg, std::string & key, const char *& value)
+{
+    value = strchr(arg, '=');
+    if (nullptr == value)
+    {
+        return false;
+    }
+    key.assign(arg, value - arg);
+    ++value;
+    return true;
+}
+
+inline bool tool_parse_option(const std::string & key, const char * value, const char * const keys[], uint32_t * const fields[], uint32_t count)
+{
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        if (key == keys[index])
+        {
+            *fields[index] = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool tool_parse_option(const std::string & key, const char * value, const char * const keys[], double * const fields[], uint32_t count)
+{
+    for (uint32_t index = 0; index < count; ++index)
+    {
+        if (key == keys[index])
+        {
+            *fields[index] = strtod(value, nullptr);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * one JSON object on stdout, written field by field: the object opens after prefix,
+ * wrap() puts the next field on a new line after indent, close() ends the object with suffix
+ */
+struct tool_json_t
+{
+    const char *            indent;
+    bool                    first;
+    bool                    wrapped;
+
+    tool_json_t(const char * prefix, const char * line_indent)
+        : indent(line_indent)
+        , first(true)
+        , wrapped(false)
+    {
+        printf("%s{", prefix);
+    }
+
+    void key(const char * name)
+    {
+        if (wrapped)
+        {
+            printf(",\n%s", indent);
+        }
+        else if (!first)
+        {
+            printf(", ");
+        }
+        printf("\"%s\": ", name);
+        first = false;
+        wrapped = false;
+    }
+
+    void wrap()
+    {
+        wrapped = true;
+    }
+
+    void number(const char * name, unsigned long long value)
+    {
+        key(name);
+        printf("%llu", value);
+    }
+
+    void real(const char * name, double value, int decimals)
+    {
+        key(name);
+        printf("%.*f", decimals, value);
+    }
+
+    void text(const char * name, const char * value)
+    {
+        key(name);
+        printf("\"%s\"", value);
+    }
+
+    void close(const char * suffix)
+    {
+        printf("}%s", suffix);
+    }
+};
+
+
+#endif // CAUCHY_FEC_TEST_TOOL_H